@@ -19,10 +19,57 @@ inline const size_t MaxModules = 32;
 inline const size_t GlobalObjectSize = 1000;
 
 // ECS
-// PoolNode初始大小
+// PoolNode初始大小, 会被向上取整到2的幂
 inline const size_t ObjectPoolInitSize = 32;
-// PoolNode扩容倍数
-inline const size_t ObjectPoolStepTimesSize = 2;
+// 每个线程的弹匣中预留的Slot数量
+inline const uint32_t ObjectPoolMagazineSize = 64;
+// 可以并发分配的最大线程数
+inline const uint32_t ObjectPoolMaxThreads = 64;
+// 每帧压缩ObjectPool的时间预算(微秒)
+inline const size_t ObjectPoolCompactBudget = 200;
+// 最多的Component<T>类型数量, 必须是64的倍数
+inline const uint32_t MaxComponentTypes = 128;
+// GameObject中直接存储在对象内部的组件数量, 超过后才分配堆内存
+inline const uint32_t GameObjectInlineComponents = 4;
+// Archetype中每个Chunk的目标大小(字节)
+inline const size_t ArchetypeChunkSize = 16 * 1024;
+
+// Events
+// 投递事件的帧内存每一块的大小(字节), 更大的事件单独分配一块
+inline const size_t EventArenaBlockSize = 64 * 1024;
+// 委托内部存储可调用对象的大小(字节), 能放下捕获两个指针的lambda, 更大的可调用对象分配堆内存
+inline const size_t DelegateInlineSize = 16;
+// 委托列表内部存储的委托数量, 大部分EventProperty只有一两个订阅者
+inline const size_t DelegateListInlineCount = 2;
+
+// Job
+// TransformSystem并行计算世界矩阵时每个任务块的Transform数量, 比这更小的层串行计算
+inline const size_t TransformJobGrain = 512;
+
+// Spatial
+// DynamicBVH中叶子包围盒向外放大的距离, 物体在这个范围内移动时不需要修改树
+inline const float DynamicBVHMargin = 0.1f;
+
+// SpatialHash
+// 空间哈希网格默认的格子边长, 和常见的查询半径同一个量级时效果最好
+inline const float SpatialHashCellSize = 4.0f;
+
+// Occlusion
+// 软件遮挡剔除的深度缓冲分辨率, 必须是8的倍数
+inline const uint32_t OcclusionBufferWidth  = 256;
+inline const uint32_t OcclusionBufferHeight = 128;
+
+// LOD
+// 每个Mesh最多的LOD级数, 包括原始的网格
+inline const uint32_t MeshMaxLods = 4;
+// 顶点聚类简化时LOD1每个轴上的格子数量, 之后每一级减半
+inline const uint32_t MeshLodBaseGrid = 64;
+// 简化之后的三角形数量超过上一级的这个比例时不再生成更粗糙的LOD
+inline const float MeshLodMinReduction = 0.8f;
+// 包围球投影到屏幕上的高度占比大于等于这个值时使用这一级, 最后一级总是可用
+inline const float MeshLodScreenSizes[MeshMaxLods] = {0.25f, 0.1f, 0.04f, 0.0f};
+// LOD切换的滞后比例, 屏幕大小要越过阈值这个比例才会切换, 避免在阈值附近来回跳变
+inline const float LodHysteresis = 0.1f;
 
 // 最大VertexAttribute数量
 inline const size_t MaxVertexAttributes = 16;
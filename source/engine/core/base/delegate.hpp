@@ -0,0 +1,352 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "core/solis_core.hpp"
+#include "core/base/using.hpp"
+#include "core/base/const.hpp"
+
+namespace solis {
+template <typename Signature, size_t Capacity = DelegateInlineSize>
+class Delegate;
+
+/**
+ * @brief 只能移动的可调用对象, 不超过Capacity字节的可调用对象直接存储在内部, 更大的才分配堆内存
+ * 只捕获几个指针的lambda不会分配内存, 调用是一次间接函数调用
+ */
+template <typename R, typename... Args, size_t Capacity>
+class Delegate<R(Args...), Capacity>
+{
+public:
+    Delegate() = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Delegate> && std::is_invocable_r_v<R, std::decay_t<F> &, Args...>>>
+    Delegate(F &&function)
+    {
+        using Callable = std::decay_t<F>;
+        if constexpr (IsInline<Callable>)
+        {
+            ::new (static_cast<void *>(mStorage)) Callable(std::forward<F>(function));
+            mInvoke = [](void *storage, Args... args) -> R {
+                return (*std::launder(static_cast<Callable *>(storage)))(std::forward<Args>(args)...);
+            };
+            mManage = [](Operation operation, void *dst, void *src) {
+                auto callable = std::launder(static_cast<Callable *>(src));
+                if (operation == Operation::Move)
+                {
+                    ::new (dst) Callable(std::move(*callable));
+                }
+                callable->~Callable();
+            };
+        }
+        else
+        {
+            *reinterpret_cast<Callable **>(mStorage) = new Callable(std::forward<F>(function));
+            mInvoke                                  = [](void *storage, Args... args) -> R {
+                return (**static_cast<Callable **>(storage))(std::forward<Args>(args)...);
+            };
+            mManage = [](Operation operation, void *dst, void *src) {
+                auto callable = *static_cast<Callable **>(src);
+                if (operation == Operation::Move)
+                {
+                    *static_cast<Callable **>(dst) = callable;
+                    return;
+                }
+                delete callable;
+            };
+        }
+    }
+
+    Delegate(Delegate &&other) noexcept
+    {
+        MoveFrom(other);
+    }
+
+    Delegate &operator=(Delegate &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    Delegate(const Delegate &)            = delete;
+    Delegate &operator=(const Delegate &) = delete;
+
+    ~Delegate()
+    {
+        Reset();
+    }
+
+    void Reset()
+    {
+        if (mManage != nullptr)
+        {
+            mManage(Operation::Destroy, nullptr, mStorage);
+        }
+        mInvoke = nullptr;
+        mManage = nullptr;
+    }
+
+    explicit operator bool() const
+    {
+        return mInvoke != nullptr;
+    }
+
+    R operator()(Args... args) const
+    {
+        assert(mInvoke != nullptr && "Delegate: calling an empty delegate");
+        return mInvoke(const_cast<std::byte *>(mStorage), std::forward<Args>(args)...);
+    }
+
+private:
+    enum class Operation
+    {
+        Move,
+        Destroy,
+    };
+
+    template <typename Callable>
+    static constexpr bool IsInline = sizeof(Callable) <= Capacity && alignof(Callable) <= alignof(std::max_align_t) &&
+                                     std::is_nothrow_move_constructible_v<Callable>;
+
+    void MoveFrom(Delegate &other)
+    {
+        if (other.mManage != nullptr)
+        {
+            other.mManage(Operation::Move, mStorage, other.mStorage);
+        }
+        mInvoke       = other.mInvoke;
+        mManage       = other.mManage;
+        other.mInvoke = nullptr;
+        other.mManage = nullptr;
+    }
+
+    alignas(std::max_align_t) std::byte mStorage[Capacity < sizeof(void *) ? sizeof(void *) : Capacity];
+
+    R (*mInvoke)(void *storage, Args... args)                 = nullptr;
+    void (*mManage)(Operation operation, void *dst, void *src) = nullptr;
+};
+
+/**
+ * @brief 委托列表, 前InlineCount个委托存储在内部, 更多的才放到堆上
+ * 订阅返回一个令牌, 用于之后取消订阅, 调用时按订阅的顺序, 没有哈希查找也不分配内存
+ *
+ * 回调中可以取消任何订阅, 被取消的委托在这一次调用中不会再被调用
+ * 回调中新增的订阅在下一次调用时才生效
+ */
+template <typename Signature, size_t InlineCount = DelegateListInlineCount>
+class DelegateList;
+
+template <typename... Args, size_t InlineCount>
+class DelegateList<bool(Args...), InlineCount>
+{
+public:
+    using Token = uint32_t;
+
+    inline static const Token InvalidToken = 0;
+
+    DelegateList() = default;
+
+    DelegateList(const DelegateList &)            = delete;
+    DelegateList &operator=(const DelegateList &) = delete;
+
+    template <typename F>
+    Token Subscribe(F &&function)
+    {
+        auto token = ++mNextToken;
+        if (token == InvalidToken)
+        {
+            token = ++mNextToken;
+        }
+
+        Entry entry{token, Callback(std::forward<F>(function))};
+        if (mInvoking > 0)
+        {
+            mPending.push_back(std::move(entry));
+        }
+        else
+        {
+            Append(std::move(entry));
+        }
+        return token;
+    }
+
+    /**
+     * @brief 取消订阅, 令牌已经失效时什么都不做
+     *
+     * @return true 找到并取消了订阅
+     */
+    bool Unsubscribe(Token token)
+    {
+        if (token == InvalidToken)
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < mCount; ++i)
+        {
+            auto &entry = At(i);
+            if (entry.token == token)
+            {
+                // 调用中只做标记, 委托可能正在执行(取消自己), 调用结束之后在压缩时再析构
+                entry.token = InvalidToken;
+                mRemoved    = true;
+                if (mInvoking == 0)
+                {
+                    entry.callback.Reset();
+                    Compact();
+                }
+                return true;
+            }
+        }
+
+        for (auto it = mPending.begin(); it != mPending.end(); ++it)
+        {
+            if (it->token == token)
+            {
+                mPending.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief 按订阅的顺序调用所有的委托, 忽略返回值
+     */
+    void Invoke(Args... args)
+    {
+        mInvoking++;
+        auto count = mCount;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto &entry = At(i);
+            if (entry.token != InvalidToken)
+            {
+                entry.callback(args...);
+            }
+        }
+
+        if (--mInvoking == 0)
+        {
+            if (mRemoved)
+            {
+                Compact();
+            }
+            if (!mPending.empty())
+            {
+                for (auto &entry : mPending)
+                {
+                    Append(std::move(entry));
+                }
+                mPending.clear();
+            }
+        }
+    }
+
+    size_t Count() const
+    {
+        return mCount + mPending.size();
+    }
+
+    bool Empty() const
+    {
+        return Count() == 0;
+    }
+
+    /**
+     * @brief 取消所有的订阅, 不能在调用中使用
+     */
+    void Clear()
+    {
+        assert(mInvoking == 0 && "DelegateList::Clear: cannot clear while invoking");
+
+        for (uint32_t i = 0; i < std::min<uint32_t>(mCount, InlineCount); ++i)
+        {
+            mInline[i] = Entry();
+        }
+        mSpill.clear();
+        mPending.clear();
+        mCount   = 0;
+        mRemoved = false;
+    }
+
+private:
+    using Callback = Delegate<bool(Args...)>;
+
+    struct Entry
+    {
+        Token    token = InvalidToken;
+        Callback callback;
+    };
+
+    Entry &At(uint32_t index)
+    {
+        return index < InlineCount ? mInline[index] : mSpill[index - InlineCount];
+    }
+
+    void Append(Entry &&entry)
+    {
+        if (mCount < InlineCount)
+        {
+            mInline[mCount] = std::move(entry);
+        }
+        else
+        {
+            mSpill.push_back(std::move(entry));
+        }
+        mCount++;
+    }
+
+    /**
+     * @brief 去掉被取消的委托, 保持剩下的顺序
+     */
+    void Compact()
+    {
+        uint32_t write = 0;
+        for (uint32_t read = 0; read < mCount; ++read)
+        {
+            auto &entry = At(read);
+            if (entry.token == InvalidToken)
+            {
+                entry.callback.Reset();
+                continue;
+            }
+            if (write != read)
+            {
+                At(write) = std::move(entry);
+            }
+            write++;
+        }
+
+        for (auto i = write; i < std::min<uint32_t>(mCount, InlineCount); ++i)
+        {
+            mInline[i] = Entry();
+        }
+        if (write < mCount && mCount > InlineCount)
+        {
+            mSpill.resize(write > InlineCount ? write - InlineCount : 0);
+        }
+        mCount   = write;
+        mRemoved = false;
+    }
+
+    Entry         mInline[InlineCount];
+    vector<Entry> mSpill;
+    // 调用中新增的订阅
+    vector<Entry> mPending;
+
+    uint32_t mCount     = 0;
+    Token    mNextToken = InvalidToken;
+    uint32_t mInvoking  = 0;
+    bool     mRemoved   = false;
+};
+} // namespace solis
@@ -1 +1,182 @@
-#include "core/base/ecs.hpp"
\ No newline at end of file
+#include "core/base/ecs.hpp"
+
+namespace solis {
+ObjectPoolBase::ObjectPoolBase()
+{
+    // Component的ObjectPool可能在工作线程中第一次被创建
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    Registry().push_back(this);
+}
+
+ObjectPoolBase::~ObjectPoolBase()
+{
+    Unregister();
+}
+
+void ObjectPoolBase::Unregister()
+{
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+
+    auto &registry = Registry();
+    auto  it       = std::find(registry.begin(), registry.end(), this);
+    if (it != registry.end())
+    {
+        registry.erase(it);
+    }
+}
+
+void ObjectPoolBase::CompactAll(std::chrono::nanoseconds budget)
+{
+    // 每帧从上一帧停下的地方继续, 避免排在前面的ObjectPool一直占用预算
+    static size_t cursor = 0;
+
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+
+    auto &registry = Registry();
+    auto  deadline = std::chrono::steady_clock::now() + budget;
+    for (size_t i = 0; i < registry.size(); ++i)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            break;
+        }
+
+        cursor %= registry.size();
+        if (registry[cursor]->Compact(deadline - now))
+        {
+            cursor++;
+        }
+    }
+}
+
+void ObjectPoolBase::SaveAll(SnapshotWriter &writer)
+{
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+
+    for (auto pool : Registry())
+    {
+        auto offset = writer.BeginBlock(pool->GetTypeHash());
+        if (pool->Save(writer))
+        {
+            writer.EndBlock(offset);
+        }
+        else
+        {
+            writer.CancelBlock(offset);
+        }
+    }
+}
+
+size_t ObjectPoolBase::LoadAll(SnapshotReader &reader)
+{
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+
+    // 同一种类型可能有多个ObjectPool, 按注册顺序和块的顺序一一对应
+    auto                    &registry = Registry();
+    vector<ObjectPoolBase *> loaded;
+    size_t                   count = 0;
+
+    uint64_t       tag = 0;
+    SnapshotReader block(nullptr, 0);
+    while (reader.ReadBlock(tag, block))
+    {
+        auto it = std::find_if(registry.begin(), registry.end(), [&](ObjectPoolBase *pool) {
+            return pool->GetTypeHash() == tag && std::find(loaded.begin(), loaded.end(), pool) == loaded.end();
+        });
+        if (it == registry.end())
+        {
+            continue;
+        }
+
+        loaded.push_back(*it);
+        if ((*it)->Load(block))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief 线程编号的分配器, 退出的线程的编号放回空闲列表
+ * 故意不析构, 其他线程可能在静态对象析构之后才退出
+ */
+struct ThreadIndexAllocator
+{
+    std::mutex       mutex;
+    vector<uint32_t> free;
+    uint32_t         next = 0;
+
+    static ThreadIndexAllocator &Get()
+    {
+        static auto allocator = new ThreadIndexAllocator();
+        return *allocator;
+    }
+};
+
+/**
+ * @brief 每个线程持有一个, 析构时交还线程私有数据和编号
+ */
+struct ThreadIndexHolder
+{
+    uint32_t index = ObjectPoolMaxThreads;
+
+    ThreadIndexHolder()
+    {
+        auto                       &allocator = ThreadIndexAllocator::Get();
+        std::lock_guard<std::mutex> lock(allocator.mutex);
+        if (!allocator.free.empty())
+        {
+            index = allocator.free.back();
+            allocator.free.pop_back();
+        }
+        else if (allocator.next < ObjectPoolMaxThreads)
+        {
+            index = allocator.next++;
+        }
+    }
+
+    ~ThreadIndexHolder()
+    {
+        if (index >= ObjectPoolMaxThreads)
+        {
+            return;
+        }
+
+        // 先交还线程私有数据, 编号被下一个线程拿到之前这个线程的弹匣已经不在原来的位置了
+        ObjectPoolBase::ReleaseThreadAll(index);
+
+        auto                       &allocator = ThreadIndexAllocator::Get();
+        std::lock_guard<std::mutex> lock(allocator.mutex);
+        allocator.free.push_back(index);
+    }
+};
+
+uint32_t ObjectPoolBase::ThreadIndex()
+{
+    thread_local ThreadIndexHolder holder;
+    return holder.index;
+}
+
+void ObjectPoolBase::ReleaseThreadAll(uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    for (auto pool : Registry())
+    {
+        pool->ReleaseThread(index);
+    }
+}
+
+vector<ObjectPoolBase *> &ObjectPoolBase::Registry()
+{
+    static vector<ObjectPoolBase *> registry;
+    return registry;
+}
+
+std::mutex &ObjectPoolBase::RegistryMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+} // namespace solis
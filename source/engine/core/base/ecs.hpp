@@ -5,273 +5,1666 @@
 #include "core/base/using.hpp"
 
 #include "core/base/const.hpp"
+#include "core/base/snapshot.hpp"
 
 #include "core/base/i_noncopyable.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+#include "ctti/type_id.hpp"
 
 namespace solis {
+/**
+ * @brief 这里为啥是EntityID，而不是ObjectID呢？
+ * 因为就是想单纯和ObjectID区分开来，这里的ID是从ObjectPool中分配出来的
+ * 为啥ObjectPool不叫EntityPool呢？
+ * 因为这是一个通用的ObjectPool，不仅仅是EntityPool
+ * 但是分配出来的是一种特化的Object(也就是Entity)
+ *
+ * EntityID是一个纯粹的64位值, 不继承Object, 可以被随意拷贝和存储
+ * 其中的Generation会在Slot被释放时递增, 所以指向已经被复用的Slot的旧ID会被检测出来
+ */
+class EntityID
+{
+public:
+    EntityID() = default;
+    EntityID(uint32_t index, uint32_t generation) :
+        mUint64(((uint64_t)generation << 32) | index)
+    {
+    }
+    ~EntityID() = default;
+
+    /**
+     * @brief 句柄在ObjectPool句柄表中的下标, 句柄表再指向实际的Slot
+     * 所以Entity在压缩时被移动了, ID也不会改变
+     */
+    uint32_t GetIndex() const
+    {
+        return static_cast<uint32_t>(mUint64 & 0xFFFFFFFF);
+    }
+
+    uint32_t GetGeneration() const
+    {
+        return static_cast<uint32_t>(mUint64 >> 32);
+    }
+
+    uint64_t GetUint64() const
+    {
+        return mUint64;
+    }
+
+    bool IsValid() const
+    {
+        return mUint64 != 0;
+    }
+
+    // operator ==
+    bool operator==(const EntityID &other) const
+    {
+        return mUint64 == other.mUint64;
+    }
+
+private:
+    // mGeneration(32) | mIndex(32)
+    uint64_t mUint64 = 0;
+};
+
+static_assert(sizeof(EntityID) == sizeof(uint64_t), "EntityID must stay a compact 64-bit handle");
+
+/**
+ * @brief ObjectPool在压缩时是否可以移动T
+ * 默认只有平凡可拷贝的类型才可以移动, 因为外部可能持有T的裸指针
+ * 如果T只通过EntityID被访问, 可以特化这个模板来允许移动
+ */
+template <typename T>
+struct ObjectPoolRelocatable : std::bool_constant<std::is_trivially_copyable_v<T>>
+{
+};
+
 template <typename T>
 class ObjectPoolNode : public Object<ObjectPoolNode<T>>, public INonCopyable
 {
-    OBJECT_NEW_DELETE(ObjectPoolNode)
 public:
+    OBJECT_NEW_DELETE(ObjectPoolNode)
+
+    // 空闲链表的结束标记
+    inline static const uint32_t InvalidIndex = 0xFFFFFFFF;
+
     ObjectPoolNode(size_t size) :
-        mSize(size),
-        mBack(0)
+        mSize(static_cast<uint32_t>(size))
+    {
+        assert(std::has_single_bit(size) && "ObjectPoolNode: size must be power of two");
+
+        mSlots   = static_cast<Slot *>(operator new[](size * sizeof(Slot)));
+        mHandles = static_cast<uint32_t *>(operator new[](size * sizeof(uint32_t)));
+        mAlive   = static_cast<uint64_t *>(operator new[](AliveWords() * sizeof(uint64_t)));
+
+        // 初始化时所有的Slot都串在空闲链表上, 链表直接存储在Slot的内存中
+        for (uint32_t i = 0; i < mSize; ++i)
+        {
+            mSlots[i].next = i + 1 < mSize ? i + 1 : InvalidIndex;
+            mHandles[i]    = InvalidIndex;
+        }
+        std::fill(mAlive, mAlive + AliveWords(), 0);
+        mFreeHead = 0;
+    }
+
+    ~ObjectPoolNode()
+    {
+        ForEach([](T &entity) { entity.~T(); });
+
+        operator delete[](mSlots);
+        operator delete[](mHandles);
+        operator delete[](mAlive);
+    }
+
+    /**
+     * @brief 从空闲链表头部取出一个Slot并绑定句柄, 不构造T, O(1)
+     * 预留的Slot在Publish之前不算存活, 遍历时会被跳过
+     *
+     * @param handle Slot对应的句柄下标
+     * @return uint32_t Slot的下标, 节点已满时返回InvalidIndex
+     */
+    uint32_t ReserveSlot(uint32_t handle)
+    {
+        if (mFreeHead == InvalidIndex)
+        {
+            return InvalidIndex;
+        }
+
+        auto index = mFreeHead;
+        mFreeHead  = mSlots[index].next;
+
+        mHandles[index] = handle;
+        mCount++;
+        return index;
+    }
+
+    /**
+     * @brief 把预留的Slot放回空闲链表头部, O(1)
+     *
+     * @param index Slot的下标
+     */
+    void ReleaseSlot(uint32_t index)
+    {
+        assert(index < mSize && !IsAlive(index));
+
+        mSlots[index].next = mFreeHead;
+        mFreeHead          = index;
+
+        mHandles[index] = InvalidIndex;
+        mCount--;
+    }
+
+    /**
+     * @brief 标记Slot存活, 不同线程可以同时Publish同一个节点中的不同Slot
+     */
+    void Publish(uint32_t index)
+    {
+        std::atomic_ref<uint64_t>(mAlive[index >> 6]).fetch_or(uint64_t(1) << (index & 63), std::memory_order_release);
+    }
+
+    /**
+     * @brief 标记Slot不再存活, Slot仍然是预留状态
+     */
+    void Retract(uint32_t index)
+    {
+        std::atomic_ref<uint64_t>(mAlive[index >> 6]).fetch_and(~(uint64_t(1) << (index & 63)), std::memory_order_release);
+    }
+
+    /**
+     * @brief 按地址顺序遍历节点中所有存活的Entity, 通过存活位图跳过空闲的Slot
+     *
+     * @param func void(T &) 或者 void(T &, uint32_t index)
+     */
+    template <typename Func>
+    void ForEach(Func &&func)
+    {
+        auto words = AliveWords();
+        for (uint32_t w = 0; w < words; ++w)
+        {
+            auto bits = mAlive[w];
+            while (bits != 0)
+            {
+                auto index = (w << 6) + static_cast<uint32_t>(std::countr_zero(bits));
+                bits &= bits - 1;
+
+                if constexpr (std::is_invocable_v<Func, T &, uint32_t>)
+                {
+                    func(mSlots[index].entity, index);
+                }
+                else
+                {
+                    func(mSlots[index].entity);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief 找到index(包括)之后的第一个存活的Slot
+     *
+     * @return uint32_t 没有则返回Size()
+     */
+    uint32_t NextAlive(uint32_t index) const
+    {
+        auto words = AliveWords();
+        auto w     = index >> 6;
+        if (w >= words)
+        {
+            return mSize;
+        }
+
+        auto bits = mAlive[w] & (~uint64_t(0) << (index & 63));
+        while (bits == 0)
+        {
+            if (++w >= words)
+            {
+                return mSize;
+            }
+            bits = mAlive[w];
+        }
+        return std::min(mSize, (w << 6) + static_cast<uint32_t>(std::countr_zero(bits)));
+    }
+
+    /**
+     * @brief 找到最后一个存活的Slot
+     *
+     * @return uint32_t 没有则返回InvalidIndex
+     */
+    uint32_t LastAlive() const
+    {
+        for (auto w = AliveWords(); w-- > 0;)
+        {
+            if (mAlive[w] != 0)
+            {
+                return (w << 6) + 63 - static_cast<uint32_t>(std::countl_zero(mAlive[w]));
+            }
+        }
+        return InvalidIndex;
+    }
+
+    T &GetEntity(uint32_t index)
+    {
+        assert(index < mSize);
+        return mSlots[index].entity;
+    }
+
+    void *GetSlot(uint32_t index)
+    {
+        assert(index < mSize);
+        return &mSlots[index].entity;
+    }
+
+    bool IsAlive(uint32_t index) const
+    {
+        // 其他线程可能同时在Publish同一个字中的其他Slot
+        auto word = std::atomic_ref<uint64_t>(const_cast<uint64_t &>(mAlive[index >> 6])).load(std::memory_order_acquire);
+        return (word >> (index & 63)) & 1;
+    }
+
+    /**
+     * @brief Slot对应的句柄下标, 预留的Slot也有句柄
+     */
+    uint32_t GetHandle(uint32_t index) const
+    {
+        assert(index < mSize);
+        return mHandles[index];
+    }
+
+    bool IsFull() const
+    {
+        return mFreeHead == InvalidIndex;
+    }
+
+    /**
+     * @brief 记录节点在version时被修改过, 多个线程可以同时调用
+     */
+    void MarkChanged(uint32_t version)
+    {
+        std::atomic_ref<uint32_t>(mChangeVersion).store(version, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 节点最后一次被修改时的版本
+     */
+    uint32_t ChangeVersion() const
+    {
+        return std::atomic_ref<const uint32_t>(mChangeVersion).load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 把节点写入存档, 平凡可拷贝的类型整块写入(包括空闲链表), 其他类型逐个序列化
+     */
+    void Save(SnapshotWriter &writer) const
+    {
+        writer.Write(mCount);
+        writer.Write(mAlive, AliveWords() * sizeof(uint64_t));
+        writer.Write(mHandles, mSize * sizeof(uint32_t));
+
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            writer.Write(mFreeHead);
+            writer.Write(mSlots, mSize * sizeof(Slot));
+        }
+        else
+        {
+            const_cast<ObjectPoolNode *>(this)->ForEach([&](T &entity) {
+                SnapshotSerializer<T>::Write(writer, entity);
+            });
+        }
+    }
+
+    /**
+     * @brief 从存档中读取节点, 节点必须是刚创建的空节点
+     *
+     * @return false 数据不完整, 此时节点中只有已经成功读取的Entity
+     */
+    bool Load(SnapshotReader &reader)
+    {
+        assert(mCount == 0);
+
+        uint32_t count = 0;
+        vector<uint64_t> alive(AliveWords());
+        if (!reader.Read(count) ||
+            !reader.Read(alive.data(), alive.size() * sizeof(uint64_t)) ||
+            !reader.Read(mHandles, mSize * sizeof(uint32_t)))
+        {
+            return false;
+        }
+
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            if (!reader.Read(mFreeHead) || !reader.Read(mSlots, mSize * sizeof(Slot)))
+            {
+                // 恢复成空节点
+                std::fill(mHandles, mHandles + mSize, InvalidIndex);
+                RebuildFreeList();
+                return false;
+            }
+            std::copy(alive.begin(), alive.end(), mAlive);
+            mCount = count;
+            return true;
+        }
+        else
+        {
+            // 逐个构造, 只有构造成功的Entity才会被标记为存活
+            bool success = true;
+            for (uint32_t w = 0; w < alive.size() && success; ++w)
+            {
+                auto bits = alive[w];
+                while (bits != 0)
+                {
+                    auto index = (w << 6) + static_cast<uint32_t>(std::countr_zero(bits));
+                    bits &= bits - 1;
+
+                    if (!SnapshotSerializer<T>::Read(reader, &mSlots[index].entity))
+                    {
+                        success = false;
+                        break;
+                    }
+                    mAlive[w] |= uint64_t(1) << (index & 63);
+                }
+            }
+
+            RebuildFreeList();
+            return success;
+        }
+    }
+
+    /**
+     * @brief 存活和预留的Slot数量
+     */
+    uint32_t Count() const
+    {
+        return mCount;
+    }
+
+    uint32_t Size() const
+    {
+        return mSize;
+    }
+
+private:
+    uint32_t AliveWords() const
+    {
+        return (mSize + 63) >> 6;
+    }
+
+    // 按存活位图重新串起空闲链表, 并重新计算数量
+    void RebuildFreeList()
+    {
+        mFreeHead = InvalidIndex;
+        mCount    = 0;
+        for (auto i = mSize; i-- > 0;)
+        {
+            if (IsAlive(i))
+            {
+                mCount++;
+                continue;
+            }
+            mSlots[i].next = mFreeHead;
+            mFreeHead      = i;
+            mHandles[i]    = InvalidIndex;
+        }
+    }
+
+    // 空闲时Slot的内存用来存储下一个空闲Slot的下标
+    union Slot
+    {
+        Slot()
+        {
+        }
+        ~Slot()
+        {
+        }
+
+        T        entity;
+        uint32_t next;
+    };
+
+    Slot     *mSlots   = nullptr;
+    uint32_t *mHandles = nullptr;
+    // 存活位图, 用于快速遍历
+    uint64_t      *mAlive    = nullptr;
+    uint32_t       mFreeHead = InvalidIndex;
+    uint32_t       mCount    = 0;
+    const uint32_t mSize;
+    // 节点中任意Entity最后一次被修改时的版本
+    uint32_t       mChangeVersion = 0;
+};
+
+enum class ObjectPoolIncreaseType
+{
+    Linear,      // 线性增长, 每个节点大小相同
+    Exponential, // 指数增长, 每个节点是上一个节点的两倍
+};
+
+/**
+ * @brief 分段数组, 第k段的大小是 2^(SegmentShift + k)
+ * 元素一旦创建就不会被移动, 所以一个线程在末尾追加元素时, 其他线程可以安全地访问已经存在的元素
+ */
+template <typename T>
+class SegmentedArray : public INonCopyable
+{
+public:
+    inline static const uint32_t SegmentShift = 6;
+
+    SegmentedArray() = default;
+
+    ~SegmentedArray()
+    {
+        while (!empty())
+        {
+            pop_back();
+        }
+        for (auto segment : mSegments)
+        {
+            operator delete[](segment);
+        }
+    }
+
+    T &operator[](uint32_t index)
+    {
+        uint32_t segment = 0;
+        uint32_t offset  = 0;
+        Locate(index, segment, offset);
+        return mSegments[segment][offset];
+    }
+
+    const T &operator[](uint32_t index) const
+    {
+        return const_cast<SegmentedArray &>(*this)[index];
+    }
+
+    template <typename... Args>
+    T &emplace_back(Args &&...args)
+    {
+        auto     index   = size();
+        uint32_t segment = 0;
+        uint32_t offset  = 0;
+        Locate(index, segment, offset);
+
+        if (mSegments[segment] == nullptr)
+        {
+            auto count          = size_t(1) << (SegmentShift + segment);
+            mSegments[segment] = static_cast<T *>(operator new[](count * sizeof(T)));
+        }
+
+        auto ptr = ::new (&mSegments[segment][offset]) T(std::forward<Args>(args)...);
+        mSize.store(index + 1, std::memory_order_release);
+        return *ptr;
+    }
+
+    void pop_back()
+    {
+        assert(!empty());
+        auto index = size() - 1;
+        (*this)[index].~T();
+        mSize.store(index, std::memory_order_release);
+    }
+
+    T &back()
+    {
+        return (*this)[size() - 1];
+    }
+
+    uint32_t size() const
+    {
+        return mSize.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+private:
+    static void Locate(uint32_t index, uint32_t &segment, uint32_t &offset)
+    {
+        segment = static_cast<uint32_t>(std::bit_width((index >> SegmentShift) + 1)) - 1;
+        offset  = index - (((uint32_t(1) << segment) - 1) << SegmentShift);
+    }
+
+    std::array<T *, 32>   mSegments{};
+    std::atomic<uint32_t> mSize{0};
+};
+
+/**
+ * @brief 所有ObjectPool的基类, 用于在每一帧统一地做增量压缩
+ */
+class SOLIS_CORE_API ObjectPoolBase
+{
+public:
+    ObjectPoolBase();
+    virtual ~ObjectPoolBase();
+
+    /**
+     * @brief 在给定的时间内压缩ObjectPool, 可以跨帧多次调用
+     *
+     * @param budget 时间预算
+     * @return true 压缩已经完成
+     */
+    virtual bool Compact(std::chrono::nanoseconds budget) = 0;
+
+    /**
+     * @brief 在给定的时间内压缩所有的ObjectPool, 每帧调用一次
+     *
+     * @param budget 所有ObjectPool共享的时间预算
+     */
+    static void CompactAll(std::chrono::nanoseconds budget);
+
+    /**
+     * @brief ObjectPool中存储的类型
+     */
+    virtual uint64_t GetTypeHash() const = 0;
+
+    /**
+     * @brief 把ObjectPool写入存档, 只能在同步点上调用
+     *
+     * @return false 类型不支持存档(没有SnapshotSerializer), 什么都不会写入
+     */
+    virtual bool Save(SnapshotWriter &writer) = 0;
+
+    /**
+     * @brief 用存档中的数据替换ObjectPool中的所有Entity, EntityID和存档时保持一致
+     *
+     * @return false 数据不匹配或者不完整, ObjectPool会被清空
+     */
+    virtual bool Load(SnapshotReader &reader) = 0;
+
+    /**
+     * @brief 把所有支持存档的ObjectPool按块写入存档
+     */
+    static void SaveAll(SnapshotWriter &writer);
+
+    /**
+     * @brief 从存档中读取所有的块, 按类型找到已经存在的ObjectPool, 不认识的块会被跳过
+     *
+     * @return size_t 成功读取的ObjectPool数量
+     */
+    static size_t LoadAll(SnapshotReader &reader);
+
+    /**
+     * @brief 当前线程的编号, 第一次调用时分配, 用于找到每个线程自己的弹匣等线程私有数据
+     * 线程退出时编号被回收给之后的线程, 同时存在超过ObjectPoolMaxThreads个线程时返回ObjectPoolMaxThreads,
+     * 这些线程没有私有数据, 需要使用加锁的路径
+     */
+    static uint32_t ThreadIndex();
+
+protected:
+    /**
+     * @brief 从注册表中移除, 派生类在析构的最开始调用, 之后不会再收到ReleaseThread
+     */
+    void Unregister();
+
+    /**
+     * @brief 使用编号index的线程退出了, 把它的线程私有数据交还给共享的部分, 持有注册表的锁调用
+     */
+    virtual void ReleaseThread(uint32_t /*index*/)
+    {
+    }
+
+private:
+    friend struct ThreadIndexHolder;
+
+    /**
+     * @brief 线程退出时调用, 通知所有的ObjectPool
+     */
+    static void ReleaseThreadAll(uint32_t index);
+
+    static vector<ObjectPoolBase *> &Registry();
+    static std::mutex               &RegistryMutex();
+};
+
+/**
+ * @brief 分块的ObjectPool
+ * 节点的大小都是2的幂, 所以Slot的全局下标可以直接通过位运算得到节点和节点内的偏移, O(1)
+ *
+ * Linear:      节点k的范围是 [k * size, (k + 1) * size)
+ * Exponential: 节点k的范围是 [size * (2^k - 1), size * (2^(k+1) - 1))
+ *
+ * EntityID指向句柄表, 句柄表再指向Slot, 所以压缩时移动了Entity, 只需要更新句柄表
+ * 分配时总是使用下标最小的有空闲Slot的节点, 让高位的节点自然地空出来, 再由Compact释放
+ *
+ * 多线程分配使用AllocEntityConcurrent/FreeEntityConcurrent:
+ * 每个线程有一个弹匣(Magazine), 里面是预留好的(句柄, Slot), 分配和释放都只访问自己的弹匣
+ * 弹匣空了才加锁从共享的节点中批量预留, 满了就无锁地交给仓库(Depot), 其他线程补充弹匣时优先从仓库中取
+ * 遍历, 通过EntityID查找和Compact需要在没有线程在分配的同步点上调用
+ */
+template <typename T>
+class ObjectPool : public Object<ObjectPool<T>>, public ObjectPoolBase, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(ObjectPool)
+
+    using Node = ObjectPoolNode<T>;
+
+    ObjectPool(ObjectPoolIncreaseType type = ObjectPoolIncreaseType::Exponential, size_t size = ObjectPoolInitSize) :
+        mIncreaseType(type),
+        mShift(static_cast<uint32_t>(std::countr_zero(std::bit_ceil(size))))
+    {
+        Grow();
+    };
+    virtual ~ObjectPool()
+    {
+        Unregister();
+
+        for (auto &magazine : mMagazines)
+        {
+            delete magazine.load(std::memory_order_relaxed);
+        }
+
+        auto depot = mDepot.load(std::memory_order_relaxed);
+        while (depot != nullptr)
+        {
+            auto next = depot->next;
+            delete depot;
+            depot = next;
+        }
+    }
+
+    /**
+     * @brief 分配一个Entity, O(1)
+     *
+     * @param id 输出分配出来的EntityID
+     * @param args T的构造参数
+     * @return T*
+     */
+    template <typename... Args>
+    T *AllocEntity(EntityID *id, Args &&...args)
+    {
+        Reservation reservation;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            reservation = Reserve();
+        }
+        return Construct(reservation, id, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief 线程安全地分配一个Entity, 大部分时候只访问当前线程的弹匣, 不需要加锁
+     *
+     * @param id 输出分配出来的EntityID
+     * @param args T的构造参数
+     * @return T*
+     */
+    template <typename... Args>
+    T *AllocEntityConcurrent(EntityID *id, Args &&...args)
+    {
+        auto threadIndex = ThreadIndex();
+        if (threadIndex >= ObjectPoolMaxThreads)
+        {
+            return AllocEntity(id, std::forward<Args>(args)...);
+        }
+
+        auto &slot     = mMagazines[threadIndex];
+        auto  magazine = slot.load(std::memory_order_relaxed);
+        if (magazine == nullptr || magazine->count == 0)
+        {
+            magazine = Refill(slot);
+        }
+        return Construct(magazine->items[--magazine->count], id, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief 批量分配count个Entity, 只加一次锁预留所有的Slot, 线程安全
+     * 给了prototype并且T是平凡可拷贝的时候直接memcpy, 否则逐个构造
+     *
+     * @param count
+     * @param ids 输出count个EntityID, 可以为nullptr
+     * @param entities 输出count个T*
+     * @param prototype 所有Entity的初始值, 为nullptr时默认构造
+     */
+    void AllocEntities(size_t count, EntityID *ids, T **entities, const T *prototype = nullptr)
+    {
+        vector<Reservation> reservations(count);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (auto &reservation : reservations)
+            {
+                reservation = Reserve();
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto    &reservation = reservations[i];
+            EntityID id;
+            if constexpr (std::is_trivially_copyable_v<T>)
+            {
+                if (prototype != nullptr)
+                {
+                    std::memcpy(reservation.ptr, prototype, sizeof(T));
+                    entities[i] = Construct(reservation, &id, NoConstruct{});
+                }
+                else
+                {
+                    entities[i] = Construct(reservation, &id);
+                }
+            }
+            else if constexpr (std::is_copy_constructible_v<T>)
+            {
+                entities[i] = prototype != nullptr ? Construct(reservation, &id, *prototype) : Construct(reservation, &id);
+            }
+            else
+            {
+                assert(prototype == nullptr && "ObjectPool::AllocEntities: T is not copyable");
+                entities[i] = Construct(reservation, &id);
+            }
+
+            if (ids != nullptr)
+            {
+                ids[i] = id;
+            }
+        }
+    }
+
+    /**
+     * @brief 线程安全地释放一个Entity, Slot会留在当前线程的弹匣中给下一次分配使用
+     *
+     * @param id
+     * @return false 如果id已经失效
+     */
+    bool FreeEntityConcurrent(EntityID id)
+    {
+        auto threadIndex = ThreadIndex();
+        if (threadIndex >= ObjectPoolMaxThreads)
+        {
+            return FreeEntity(id);
+        }
+
+        if (!IsAlive(id))
+        {
+            return false;
+        }
+
+        auto reservation = Destruct(id);
+
+        auto &slot     = mMagazines[threadIndex];
+        auto  magazine = slot.load(std::memory_order_relaxed);
+        if (magazine == nullptr)
+        {
+            magazine = new Magazine();
+            slot.store(magazine, std::memory_order_release);
+        }
+        else if (magazine->count == ObjectPoolMagazineSize)
+        {
+            // 满了就交给仓库, 换一个空的弹匣
+            magazine = Handoff(slot);
+        }
+        magazine->items[magazine->count++] = reservation;
+        return true;
+    }
+
+    /**
+     * @brief 释放一个Entity, O(1)
+     *
+     * @param id
+     * @return false 如果id已经失效(已经被释放或者Slot已经被复用)
+     */
+    bool FreeEntity(EntityID id)
+    {
+        if (!IsAlive(id))
+        {
+            return false;
+        }
+
+        auto reservation = Destruct(id);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        Release(reservation);
+        return true;
+    }
+
+    /**
+     * @brief 通过EntityID获取Entity, O(1)
+     *
+     * @param id
+     * @return T*, 如果id已经失效则返回nullptr
+     */
+    T *GetEntity(EntityID id)
+    {
+        if (!IsAlive(id))
+        {
+            return nullptr;
+        }
+
+        uint32_t nodeIndex = 0;
+        uint32_t index     = 0;
+        Locate(mHandles[id.GetIndex()].slot, nodeIndex, index);
+        return &mNodes[nodeIndex]->GetEntity(index);
+    }
+
+    /**
+     * @brief 通过Slot的全局下标获取Entity, O(1)
+     *
+     * @param index
+     * @return T*, 如果越界或者Slot是空闲的则返回nullptr
+     */
+    T *GetEntity(size_t index)
+    {
+        uint32_t nodeIndex = 0;
+        uint32_t offset    = 0;
+        if (index > 0xFFFFFFFF || !Locate(static_cast<uint32_t>(index), nodeIndex, offset))
+        {
+            return nullptr;
+        }
+
+        auto &node = *mNodes[nodeIndex];
+        if (!node.IsAlive(offset))
+        {
+            return nullptr;
+        }
+        return &node.GetEntity(offset);
+    }
+
+    bool IsAlive(EntityID id) const
+    {
+        auto index = id.GetIndex();
+        return id.IsValid() && index < mHandles.size() && mHandles[index].generation == id.GetGeneration();
+    }
+
+    /**
+     * @brief 遍历所有存活的Entity, 按节点顺序线性访问连续的内存
+     *
+     * @param func void(T &) 或者 void(T &, EntityID)
+     */
+    template <typename Func>
+    void ForEach(Func &&func)
+    {
+        for (uint32_t nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+        {
+            auto &node = *mNodes[nodeIndex];
+            if (node.Count() == 0)
+            {
+                continue;
+            }
+
+            if constexpr (std::is_invocable_v<Func, T &, EntityID>)
+            {
+                node.ForEach([&](T &entity, uint32_t index) {
+                    func(entity, GetID(node.GetHandle(index)));
+                });
+            }
+            else
+            {
+                node.ForEach(func);
+            }
+        }
+    }
+
+    /**
+     * @brief 当前的修改版本, 修改Entity时节点会被标记为这个版本
+     */
+    uint32_t GetVersion() const
     {
-        mEntities = static_cast<T *>(operator new[](size * sizeof(T)));
-        mIndices  = static_cast<uint32_t *>(operator new[](size * sizeof(uint32_t)));
+        return mVersion.load(std::memory_order_relaxed);
+    }
 
-        for (uint32_t i = 0; i < size; ++i)
+    /**
+     * @brief 标记Entity被修改了, 只记录到节点上, O(1), 线程安全
+     *
+     * @param id
+     */
+    void MarkChanged(EntityID id)
+    {
+        if (!IsAlive(id))
         {
-            mIndices[i] = i;
+            return;
         }
+
+        uint32_t nodeIndex = 0;
+        uint32_t index     = 0;
+        Locate(mHandles[id.GetIndex()].slot, nodeIndex, index);
+        mNodes[nodeIndex]->MarkChanged(GetVersion());
     }
 
-    ~ObjectPoolNode()
+    /**
+     * @brief 只遍历自上次调用以来被修改过的节点, 没有被修改过的节点整块跳过
+     * 调用者保存返回的版本, 下一次调用时传入
+     *
+     * @param version 上一次调用返回的版本, 第一次调用时传入0会遍历所有节点
+     * @param func void(T &) 或者 void(T &, EntityID)
+     * @return uint32_t 下一次调用时应该传入的版本
+     */
+    template <typename Func>
+    uint32_t ForEachChanged(uint32_t version, Func &&func)
     {
-        operator delete[](mEntities);
-        operator delete[](mIndices);
+        // 之后的修改都会被标记为新的版本
+        auto next = mVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        for (uint32_t nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+        {
+            auto &node = *mNodes[nodeIndex];
+            if (node.Count() == 0 || node.ChangeVersion() < version)
+            {
+                continue;
+            }
+
+            if constexpr (std::is_invocable_v<Func, T &, EntityID>)
+            {
+                node.ForEach([&](T &entity, uint32_t index) {
+                    func(entity, GetID(node.GetHandle(index)));
+                });
+            }
+            else
+            {
+                node.ForEach(func);
+            }
+        }
+        return next;
     }
 
-    uint32_t AllocEntity(bool &success)
+    /**
+     * @brief 只遍历存活Entity的迭代器
+     */
+    class Iterator
     {
-        if (mBack == mSize)
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = T *;
+        using reference         = T &;
+
+        Iterator(ObjectPool *pool, uint32_t nodeIndex, uint32_t index) :
+            mPool(pool), mNodeIndex(nodeIndex), mIndex(index)
         {
-            success = false;
-            return 0;
+            Settle();
         }
 
-        success = true;
-        return mIndices[mBack++];
-    }
+        T &operator*() const
+        {
+            return mPool->mNodes[mNodeIndex]->GetEntity(mIndex);
+        }
 
-    void FreeEntity(uint32_t index)
-    {
-        // 过大就纯纯不行
-        if (index >= mSize)
+        T *operator->() const
         {
-            return;
+            return &**this;
+        }
+
+        EntityID GetID() const
+        {
+            return mPool->GetID(mPool->mNodes[mNodeIndex]->GetHandle(mIndex));
+        }
+
+        Iterator &operator++()
+        {
+            mIndex++;
+            Settle();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            auto it = *this;
+            ++*this;
+            return it;
         }
 
-        auto back = mBack;
-        for (uint32_t i = 0; i < back; ++i)
+        bool operator==(const Iterator &other) const
         {
-            if (mIndices[i] == index)
+            return mNodeIndex == other.mNodeIndex && mIndex == other.mIndex;
+        }
+
+    private:
+        // 移动到当前位置(包括)之后的第一个存活的Slot
+        void Settle()
+        {
+            while (mNodeIndex < mPool->mNodes.size())
             {
-                back--;
-                std::swap(mIndices[i], mIndices[back]);
-                break;
+                auto &node = *mPool->mNodes[mNodeIndex];
+                mIndex     = node.Count() == 0 ? node.Size() : node.NextAlive(mIndex);
+                if (mIndex < node.Size())
+                {
+                    return;
+                }
+                mNodeIndex++;
+                mIndex = 0;
             }
+            mIndex = 0;
         }
-        mBack = back;
-    }
 
-    T &GetEntity(uint32_t index)
+        ObjectPool *mPool      = nullptr;
+        uint32_t    mNodeIndex = 0;
+        uint32_t    mIndex     = 0;
+    };
+
+    Iterator begin()
     {
-        assert(index < mSize);
-        return mEntities[index];
+        return Iterator(this, 0, 0);
     }
 
-private:
-    T             *mEntities = nullptr;
-    uint32_t      *mIndices  = nullptr;
-    uint32_t       mBack;
-    const uint32_t mSize;
-};
-
-/**
- * @brief 这里为啥是EntityID，而不是ObjectID呢？
- * 因为就是想单纯和ObjectID区分开来，这里的ID是从ObjectPool中分配出来的
- * 为啥ObjectPool不叫EntityPool呢？
- * 因为这是一个通用的ObjectPool，不仅仅是EntityPool
- * 但是分配出来的是一种特化的Object(也就是Entity)
- */
-class EntityID : public Object<EntityID>
-{
-public:
-    EntityID() = default;
-    EntityID(uint32_t index, uint32_t poolIndex, uint64_t pool) :
-        mIndex(index),
-        mPoolIndex(poolIndex),
-        mPool(pool)
+    Iterator end()
     {
-        assert(pool <= 0xFFFF);
-        assert(poolIndex <= 0xFFFF);
+        return Iterator(this, static_cast<uint32_t>(mNodes.size()), 0);
+    }
 
-        mUint64 = (mPool << 48) | ((uint64_t)mPoolIndex << 32) | mIndex;
+    /**
+     * @brief 存活的Entity数量
+     */
+    size_t Count() const
+    {
+        return mCount.load(std::memory_order_relaxed);
     }
-    ~EntityID() = default;
 
-    uint32_t GetIndex() const
+    /**
+     * @brief 所有节点的Slot总数
+     */
+    size_t Capacity() const
     {
-        return mIndex;
+        return NodeBase(static_cast<uint32_t>(mNodes.size()));
     }
 
-    uint32_t GetPoolIndex() const
+    size_t NodeCount() const
     {
-        return mPoolIndex;
+        return mNodes.size();
     }
 
-    uint64_t GetPool() const
+    /**
+     * @brief 把高位节点中的Entity移动到低位节点的空闲Slot中, 然后释放末尾的空节点
+     * 只有ObjectPoolRelocatable<T>的类型才会被移动, 其他类型只会释放末尾的空节点
+     * 移动之后EntityID不变, 但是T的地址会改变
+     *
+     * @param budget 时间预算, 用完后返回, 下次调用时继续
+     * @return true 压缩已经完成
+     */
+    virtual bool Compact(std::chrono::nanoseconds budget) override
     {
-        return mPool;
+        auto deadline = std::chrono::steady_clock::now() + budget;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        // 弹匣中预留的Slot会让节点无法被释放, 先全部还回去
+        Reclaim();
+
+        if constexpr (ObjectPoolRelocatable<T>::value)
+        {
+            uint32_t moved = 0;
+            while (true)
+            {
+                auto low  = LowestFreeNode();
+                auto high = HighestUsedNode();
+                if (low == Node::InvalidIndex || high == Node::InvalidIndex || low >= high)
+                {
+                    break;
+                }
+
+                auto &from   = *mNodes[high];
+                auto  index  = from.LastAlive();
+                auto  handle = from.GetHandle(index);
+                auto  src    = NodeBase(high) + index;
+                auto  dst    = ReserveSlot(handle);
+                assert(index != Node::InvalidIndex && dst < NodeBase(high));
+
+                auto &entity = from.GetEntity(index);
+                ::new (GetSlot(dst)) T(std::move(entity));
+                entity.~T();
+
+                uint32_t nodeIndex = 0;
+                uint32_t offset    = 0;
+                Locate(dst, nodeIndex, offset);
+                mNodes[nodeIndex]->Publish(offset);
+                // 移动到了新的节点, 对这个节点来说也是一次修改
+                mNodes[nodeIndex]->MarkChanged(GetVersion());
+                from.Retract(index);
+
+                mHandles[handle].slot = dst;
+                ReleaseSlot(src);
+
+                // 每移动一批检查一次时间
+                if ((++moved & 31) == 0 && std::chrono::steady_clock::now() >= deadline)
+                {
+                    return false;
+                }
+            }
+        }
+
+        // 保留第一个节点
+        while (mNodes.size() > 1 && mNodes.back()->Count() == 0)
+        {
+            auto nodeIndex = static_cast<uint32_t>(mNodes.size() - 1);
+            mFreeNodes[nodeIndex >> 6] &= ~(uint64_t(1) << (nodeIndex & 63));
+            mNodes.pop_back();
+        }
+        return true;
     }
 
-    uint64_t GetUint64() const
+    virtual uint64_t GetTypeHash() const override
     {
-        return mUint64;
+        return ctti::type_id<T>().hash();
     }
 
-    bool IsValid()
+    /**
+     * @brief 存档格式: 头部, 句柄表, 然后每个节点一段连续的数据
+     */
+    virtual bool Save(SnapshotWriter &writer) override
     {
-        return mUint64 != 0;
+        if constexpr (!SnapshotSerializer<T>::Enabled)
+        {
+            return false;
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            // 弹匣中预留的Slot不应该被写入
+            Reclaim();
+
+            writer.Write(static_cast<uint32_t>(sizeof(T)));
+            writer.Write(static_cast<uint32_t>(mIncreaseType));
+            writer.Write(mShift);
+
+            writer.Write(mHandles.size());
+            writer.Write(mFreeHandle);
+            for (uint32_t i = 0; i < mHandles.size(); ++i)
+            {
+                writer.Write(mHandles[i]);
+            }
+
+            writer.Write(mNodes.size());
+            for (uint32_t i = 0; i < mNodes.size(); ++i)
+            {
+                mNodes[i]->Save(writer);
+            }
+            return true;
+        }
     }
 
-    // operator ==
-    bool operator==(const EntityID &other) const
+    virtual bool Load(SnapshotReader &reader) override
     {
-        return mUint64 == other.mUint64;
+        if constexpr (!SnapshotSerializer<T>::Enabled)
+        {
+            return false;
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            Clear();
+
+            uint32_t size         = 0;
+            uint32_t increaseType = 0;
+            uint32_t shift        = 0;
+            uint32_t handleCount  = 0;
+            if (!reader.Read(size) || !reader.Read(increaseType) || !reader.Read(shift) ||
+                size != sizeof(T) || increaseType != static_cast<uint32_t>(mIncreaseType) || shift != mShift ||
+                !reader.Read(handleCount) || !reader.Read(mFreeHandle))
+            {
+                return LoadFailed();
+            }
+
+            size_t count = 0;
+            for (uint32_t i = 0; i < handleCount; ++i)
+            {
+                auto &handle = mHandles.emplace_back();
+                if (!reader.Read(handle))
+                {
+                    return LoadFailed();
+                }
+                count += handle.generation & 1;
+            }
+
+            uint32_t nodeCount = 0;
+            if (!reader.Read(nodeCount) || nodeCount == 0)
+            {
+                return LoadFailed();
+            }
+
+            // 新读入的节点都算作被修改过
+            auto version = mVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+            for (uint32_t i = 0; i < nodeCount; ++i)
+            {
+                auto  nodeIndex = Grow();
+                auto &node      = *mNodes[nodeIndex];
+                if (!node.Load(reader))
+                {
+                    return LoadFailed();
+                }
+
+                node.MarkChanged(version);
+                if (node.IsFull())
+                {
+                    mFreeNodes[nodeIndex >> 6] &= ~(uint64_t(1) << (nodeIndex & 63));
+                }
+            }
+
+            mCount.store(count, std::memory_order_relaxed);
+            return true;
+        }
     }
 
 private:
-    // mPool(16) | mPoolIndex(16) | mIndex(32)
-    uint64_t mUint64 = 0;
-    // PoolNodeIndex | EntityIndex
-    uint32_t mIndex = 0;
-    // PoolIndex
-    uint32_t mPoolIndex = 0;
-    // Pool(uintptr_t)
-    uint64_t mPool = 0;
-};
+    struct Handle
+    {
+        // 存活时是Slot的全局下标, 空闲时是下一个空闲句柄
+        uint32_t slot = 0;
+        // 奇数代表存活, 偶数代表空闲
+        uint32_t generation = 0;
+    };
 
-enum class ObjectPoolIncreaseType
-{
-    Linear,      // 线性增长
-    Exponential, // 指数增长
-};
+    /**
+     * @brief 一个预留好的(句柄, Slot), 记录了Slot的地址, 构造和析构时不需要访问节点表
+     */
+    struct Reservation
+    {
+        void    *ptr    = nullptr;
+        Node    *node   = nullptr;
+        uint32_t index  = 0;
+        uint32_t handle = 0;
+    };
 
-template <typename T>
-class ObjectPool : public Object<ObjectPool<T>>, public INonCopyable
-{
-public:
-    ObjectPool(ObjectPoolIncreaseType type = ObjectPoolIncreaseType::Exponential, size_t size = ObjectPoolInitSize) :
-        mIncreaseType(type), mSize(size)
+    struct Magazine
+    {
+        // 在仓库中时指向下一个弹匣
+        Magazine   *next  = nullptr;
+        uint32_t    count = 0;
+        Reservation items[ObjectPoolMagazineSize];
+    };
+
+    EntityID GetID(uint32_t handle) const
+    {
+        return EntityID(handle, mHandles[handle].generation);
+    }
+
+    // 内存已经被初始化好了, 不需要构造
+    struct NoConstruct
     {
-        mNodes.emplace_back(mSize);
-        mCache.push_back(--mNodes.end());
     };
-    virtual ~ObjectPool() = default;
 
-    T *AllocEntity(EntityID *id)
+    template <typename... Args>
+    T *Construct(const Reservation &reservation, EntityID *id, Args &&...args)
+    {
+        T *ptr = nullptr;
+        if constexpr (sizeof...(Args) == 1 && (std::is_same_v<std::decay_t<Args>, NoConstruct> && ...))
+        {
+            ptr = std::launder(static_cast<T *>(reservation.ptr));
+        }
+        else
+        {
+            ptr = ::new (reservation.ptr) T(std::forward<Args>(args)...);
+        }
+
+        // 句柄由当前线程独占, 变成奇数之后EntityID才生效
+        auto &generation = mHandles[reservation.handle].generation;
+        generation++;
+        reservation.node->Publish(reservation.index);
+        reservation.node->MarkChanged(GetVersion());
+        mCount.fetch_add(1, std::memory_order_relaxed);
+
+        *id = EntityID(reservation.handle, generation);
+        return ptr;
+    }
+
+    Reservation Destruct(EntityID id)
+    {
+        auto &handle = mHandles[id.GetIndex()];
+
+        uint32_t nodeIndex = 0;
+        Reservation reservation;
+        Locate(handle.slot, nodeIndex, reservation.index);
+        reservation.node   = mNodes[nodeIndex].get();
+        reservation.handle = id.GetIndex();
+        reservation.ptr    = reservation.node->GetSlot(reservation.index);
+
+        static_cast<T *>(reservation.ptr)->~T();
+        reservation.node->Retract(reservation.index);
+        handle.generation++;
+        mCount.fetch_sub(1, std::memory_order_relaxed);
+        return reservation;
+    }
+
+    /**
+     * @brief 预留一个句柄和一个Slot, 需要持有锁
+     */
+    Reservation Reserve()
     {
+        Reservation reservation;
+        reservation.handle = ReserveHandle();
+
+        auto slot = ReserveSlot(reservation.handle);
+
         uint32_t nodeIndex = 0;
-        bool     success   = false;
+        Locate(slot, nodeIndex, reservation.index);
+        reservation.node = mNodes[nodeIndex].get();
+        reservation.ptr  = reservation.node->GetSlot(reservation.index);
+        return reservation;
+    }
 
-        for (auto &node : mNodes)
+    /**
+     * @brief 把预留的句柄和Slot还给共享的节点, 需要持有锁
+     */
+    void Release(const Reservation &reservation)
+    {
+        ReleaseSlot(mHandles[reservation.handle].slot);
+        ReleaseHandle(reservation.handle);
+    }
+
+    /**
+     * @brief 退出的线程的弹匣交给仓库, 这样它预留的Slot不会一直闲置, 编号的下一个使用者会得到一个新的弹匣
+     */
+    void ReleaseThread(uint32_t index) override
+    {
+        auto magazine = mMagazines[index].exchange(nullptr, std::memory_order_acquire);
+        if (magazine == nullptr)
         {
-            auto index = node.AllocEntity(success);
-            if (success)
-            {
-                *id = EntityID(index, nodeIndex, reinterpret_cast<uintptr_t>(this));
-                return &node.GetEntity(index);
-            }
-            nodeIndex++;
+            return;
+        }
+        if (magazine->count == 0)
+        {
+            delete magazine;
+            return;
+        }
+
+        magazine->next = mDepot.load(std::memory_order_relaxed);
+        while (!mDepot.compare_exchange_weak(magazine->next, magazine, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /**
+     * @brief 补充空的弹匣, 优先从仓库中取满的弹匣, 否则从共享的节点中批量预留
+     */
+    Magazine *Refill(std::atomic<Magazine *> &slot)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // 只有持有锁的线程会出栈, 所以不会有ABA问题
+        auto full = mDepot.load(std::memory_order_acquire);
+        while (full != nullptr && !mDepot.compare_exchange_weak(full, full->next, std::memory_order_acquire))
+        {
+        }
+
+        auto magazine = slot.load(std::memory_order_relaxed);
+        if (full != nullptr)
+        {
+            delete magazine;
+            full->next = nullptr;
+            slot.store(full, std::memory_order_release);
+            return full;
+        }
+
+        if (magazine == nullptr)
+        {
+            magazine = new Magazine();
+            slot.store(magazine, std::memory_order_release);
+        }
+
+        while (magazine->count < ObjectPoolMagazineSize)
+        {
+            magazine->items[magazine->count++] = Reserve();
         }
+        return magazine;
+    }
 
-        // 一些简单的增长策略
-        switch (mIncreaseType)
+    /**
+     * @brief 把满的弹匣无锁地交给仓库, 换一个新的空弹匣
+     */
+    Magazine *Handoff(std::atomic<Magazine *> &slot)
+    {
+        auto full  = slot.load(std::memory_order_relaxed);
+        full->next = mDepot.load(std::memory_order_relaxed);
+        while (!mDepot.compare_exchange_weak(full->next, full, std::memory_order_release, std::memory_order_relaxed))
         {
-        case ObjectPoolIncreaseType::Linear:
-            mSize += ObjectPoolStepTimesSize;
-            break;
-        case ObjectPoolIncreaseType::Exponential:
-            mSize *= ObjectPoolStepTimesSize;
-            break;
+        }
+
+        auto magazine = new Magazine();
+        slot.store(magazine, std::memory_order_release);
+        return magazine;
+    }
 
-        default:
-            assert(false && "ObjectPool::AllocEntity: unknown increase type");
-            break;
+    /**
+     * @brief 把所有弹匣和仓库中预留的Slot还给共享的节点, 只能在同步点上调用, 需要持有锁
+     */
+    void Reclaim()
+    {
+        for (auto &slot : mMagazines)
+        {
+            auto magazine = slot.load(std::memory_order_acquire);
+            if (magazine == nullptr)
+            {
+                continue;
+            }
+            while (magazine->count > 0)
+            {
+                Release(magazine->items[--magazine->count]);
+            }
         }
 
-        mNodes.emplace_back(mSize);
+        auto depot = mDepot.exchange(nullptr, std::memory_order_acquire);
+        while (depot != nullptr)
+        {
+            while (depot->count > 0)
+            {
+                Release(depot->items[--depot->count]);
+            }
+            auto next = depot->next;
+            delete depot;
+            depot = next;
+        }
+    }
 
-        auto &node = mNodes.back();
-        node.AllocEntity(success);
+    /**
+     * @brief 从空闲链表中取一个句柄, 不改变Generation
+     */
+    uint32_t ReserveHandle()
+    {
+        if (mFreeHandle != Node::InvalidIndex)
+        {
+            auto handle = mFreeHandle;
+            mFreeHandle = mHandles[handle].slot;
+            return handle;
+        }
 
-        mCache.push_back(--mNodes.end());
+        mHandles.emplace_back();
+        return mHandles.size() - 1;
+    }
 
-        assert(success);
-        *id = EntityID(0, nodeIndex, reinterpret_cast<uintptr_t>(this));
-        return &node.GetEntity(0);
+    void ReleaseHandle(uint32_t handle)
+    {
+        mHandles[handle].slot = mFreeHandle;
+        mFreeHandle           = handle;
     }
 
-    // TODO: 这里需要做成那种可缩放的
-    void FreeEntity(EntityID &id)
+    /**
+     * @brief 在下标最小的有空闲Slot的节点中预留一个Slot, 并把它绑定到句柄上
+     *
+     * @return uint32_t Slot的全局下标
+     */
+    uint32_t ReserveSlot(uint32_t handle)
     {
-        auto pool = id.GetPool();
-        assert(pool == reinterpret_cast<uintptr_t>(this));
+        auto nodeIndex = LowestFreeNode();
+        if (nodeIndex == Node::InvalidIndex)
+        {
+            nodeIndex = Grow();
+        }
+
+        auto &node  = *mNodes[nodeIndex];
+        auto  index = node.ReserveSlot(handle);
+        assert(index != Node::InvalidIndex);
 
-        auto nodeIndex = id.GetPoolIndex();
-        auto index     = id.GetIndex();
+        // 节点满了就不再参与分配
+        if (node.IsFull())
+        {
+            mFreeNodes[nodeIndex >> 6] &= ~(uint64_t(1) << (nodeIndex & 63));
+        }
 
-        auto node = mCache[nodeIndex];
-        node->FreeEntity(index);
+        auto slot             = NodeBase(nodeIndex) + index;
+        mHandles[handle].slot = slot;
+        return slot;
     }
 
-    T *GetEntity(EntityID &id)
+    void ReleaseSlot(uint32_t slot)
     {
-        auto pool = id.GetPool();
-        assert(pool == reinterpret_cast<uintptr_t>(this));
+        uint32_t nodeIndex = 0;
+        uint32_t index     = 0;
+        Locate(slot, nodeIndex, index);
 
-        auto nodeIndex = id.GetPoolIndex();
-        auto index     = id.GetIndex();
+        mNodes[nodeIndex]->ReleaseSlot(index);
+        // 节点重新有了空闲Slot
+        mFreeNodes[nodeIndex >> 6] |= uint64_t(1) << (nodeIndex & 63);
+    }
 
-        auto node = mCache[nodeIndex];
-        return node->GetEntity(index);
+    void *GetSlot(uint32_t slot)
+    {
+        uint32_t nodeIndex = 0;
+        uint32_t index     = 0;
+        Locate(slot, nodeIndex, index);
+        return mNodes[nodeIndex]->GetSlot(index);
     }
 
-    T *GetEntity(size_t index)
+    uint32_t LowestFreeNode() const
     {
-        for (auto &node : mNodes)
+        for (uint32_t w = 0; w < mFreeNodes.size(); ++w)
         {
-            if (index < node.Size())
+            if (mFreeNodes[w] != 0)
             {
-                return node.GetEntity(index);
+                return (w << 6) + static_cast<uint32_t>(std::countr_zero(mFreeNodes[w]));
             }
+        }
+        return Node::InvalidIndex;
+    }
 
-            // 过大就纯纯溢出了
-            if (index > node.Size())
+    uint32_t HighestUsedNode() const
+    {
+        for (auto nodeIndex = static_cast<uint32_t>(mNodes.size()); nodeIndex-- > 0;)
+        {
+            if (mNodes[nodeIndex]->Count() != 0)
             {
-                return nullptr;
+                return nodeIndex;
             }
+        }
+        return Node::InvalidIndex;
+    }
 
-            index -= node.Size();
+    /**
+     * @brief 节点k的第一个Slot的全局下标
+     */
+    uint32_t NodeBase(uint32_t nodeIndex) const
+    {
+        if (mIncreaseType == ObjectPoolIncreaseType::Linear)
+        {
+            return nodeIndex << mShift;
         }
+        return ((uint32_t(1) << nodeIndex) - 1) << mShift;
+    }
 
-        return nullptr;
+    uint32_t NodeSize(uint32_t nodeIndex) const
+    {
+        if (mIncreaseType == ObjectPoolIncreaseType::Linear)
+        {
+            return uint32_t(1) << mShift;
+        }
+        return uint32_t(1) << (mShift + nodeIndex);
     }
 
-private:
-    using NodeIterator = typename std::list<ObjectPoolNode<T>>::iterator;
+    /**
+     * @brief 全局下标 -> (节点, 节点内偏移), 纯位运算
+     */
+    bool Locate(uint32_t global, uint32_t &nodeIndex, uint32_t &index) const
+    {
+        if (mIncreaseType == ObjectPoolIncreaseType::Linear)
+        {
+            nodeIndex = global >> mShift;
+        }
+        else
+        {
+            nodeIndex = static_cast<uint32_t>(std::bit_width((global >> mShift) + 1)) - 1;
+        }
+
+        if (nodeIndex >= mNodes.size())
+        {
+            return false;
+        }
+
+        index = global - NodeBase(nodeIndex);
+        return true;
+    }
+
+    /**
+     * @brief 析构所有Entity, 释放所有节点和句柄, 需要持有锁
+     */
+    void Clear()
+    {
+        Reclaim();
+
+        while (!mNodes.empty())
+        {
+            mNodes.pop_back();
+        }
+        while (!mHandles.empty())
+        {
+            mHandles.pop_back();
+        }
+
+        mFreeNodes.clear();
+        mFreeHandle = Node::InvalidIndex;
+        mCount.store(0, std::memory_order_relaxed);
+    }
+
+    bool LoadFailed()
+    {
+        Clear();
+        Grow();
+        return false;
+    }
+
+    uint32_t Grow()
+    {
+        auto nodeIndex = mNodes.size();
+        assert((mIncreaseType == ObjectPoolIncreaseType::Linear || mShift + nodeIndex < 32) && "ObjectPool::Grow: too many nodes");
+
+        mNodes.emplace_back(std::make_unique<Node>(NodeSize(nodeIndex)));
+        if ((nodeIndex >> 6) >= mFreeNodes.size())
+        {
+            mFreeNodes.push_back(0);
+        }
+        mFreeNodes[nodeIndex >> 6] |= uint64_t(1) << (nodeIndex & 63);
+        return nodeIndex;
+    }
 
-    std::list<ObjectPoolNode<T>> mNodes;
-    vector<NodeIterator>         mCache;
+    // 节点和句柄都不会被移动, 所以持有锁追加时其他线程仍然可以访问已有的节点和句柄
+    SegmentedArray<std::unique_ptr<Node>> mNodes;
+    // 还有空闲Slot的节点的位图
+    vector<uint64_t> mFreeNodes;
+
+    SegmentedArray<Handle> mHandles;
+    uint32_t               mFreeHandle = Node::InvalidIndex;
 
     ObjectPoolIncreaseType mIncreaseType = ObjectPoolIncreaseType::Exponential;
-    uint32_t               mSize         = ObjectPoolInitSize;
+    // log2(节点初始大小)
+    uint32_t              mShift = 0;
+    std::atomic<size_t>   mCount{0};
+    // 修改版本, 每次ForEachChanged之后递增, 从1开始, 这样新的节点(版本0)不会被误认为被修改过
+    std::atomic<uint32_t> mVersion{1};
+
+    // 保护节点的空闲链表, 句柄的空闲链表和节点表的增长
+    std::mutex mMutex;
+    // 每个线程一个弹匣, 按ThreadIndex()索引
+    std::array<std::atomic<Magazine *>, ObjectPoolMaxThreads> mMagazines{};
+    // 装满了被释放的Slot的弹匣, 无锁入栈, 持有锁出栈
+    std::atomic<Magazine *> mDepot{nullptr};
 };
 
 /**
- * @brief 一个ObjectPool的Vector版本
+ * @brief 一个ObjectPool的Vector版本, 只增不减, 所以第n个元素就在全局下标n的Slot上
  *
  * @tparam T
  */
 template <typename T>
-class ObjectPoolVector : public ObjectPool<ObjectPoolVector<T>>
+class ObjectPoolVector : public ObjectPool<T>
 {
 public:
-    using Pool = ObjectPool<ObjectPoolVector<T>>;
+    using Pool = ObjectPool<T>;
     ObjectPoolVector() :
         Pool(ObjectPoolIncreaseType::Linear){};
     virtual ~ObjectPoolVector() = default;
@@ -281,8 +1674,8 @@ public:
         EntityID id;
 
         // 这里不存储id
-        T *allocEle = Pool::AllocEntity(&id);
-        *allocEle   = ele;
+        Pool::AllocEntity(&id, ele);
+        assert(Pool::GetEntity(mVectorSize) == Pool::GetEntity(id));
 
         mVectorSize++;
     }
@@ -299,6 +1692,20 @@ public:
         return *Pool::GetEntity(index);
     }
 
+    virtual bool Compact(std::chrono::nanoseconds budget) override
+    {
+        // 下标就是Slot的位置, 不能移动
+        return true;
+    }
+
+    virtual bool Load(SnapshotReader &reader) override
+    {
+        auto success = Pool::Load(reader);
+        // 只增不减, 所以元素的数量就是存活的数量
+        mVectorSize = Pool::Count();
+        return success;
+    }
+
 private:
     size_t mVectorSize = 0;
 };
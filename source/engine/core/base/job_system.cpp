@@ -0,0 +1,122 @@
+#include "core/base/job_system.hpp"
+
+namespace solis {
+// 当前线程是否正在执行任务, 用于检测嵌套调用
+static thread_local bool InsideJob = false;
+
+JobSystem::JobSystem()
+{
+    auto hardware = std::max<uint32_t>(std::thread::hardware_concurrency(), 1);
+    SetWorkerCount(hardware - 1);
+}
+
+JobSystem::~JobSystem()
+{
+    StopWorkers();
+}
+
+void JobSystem::SetWorkerCount(uint32_t count)
+{
+    std::lock_guard<std::mutex> dispatchLock(mDispatchMutex);
+
+    StopWorkers();
+
+    // 工作线程也可能分配组件, 每个线程都需要一个ObjectPool的线程编号
+    count = std::min(count, ObjectPoolMaxThreads - 1);
+
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop      = false;
+        generation = mGeneration;
+    }
+
+    mWorkers.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        mWorkers.emplace_back([this, generation]() { WorkerLoop(generation); });
+    }
+}
+
+bool JobSystem::IsInsideJob()
+{
+    return InsideJob;
+}
+
+void JobSystem::Dispatch(size_t count, size_t grain, void *context, JobFunc func)
+{
+    std::lock_guard<std::mutex> dispatchLock(mDispatchMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mContext = context;
+        mFunc    = func;
+        mCount   = count;
+        mGrain   = grain;
+        mNext.store(0, std::memory_order_relaxed);
+        mActive = static_cast<uint32_t>(mWorkers.size());
+        mGeneration++;
+    }
+    mWakeCondition.notify_all();
+
+    Execute();
+
+    // 等待所有工作线程退出当前任务, 之后才能释放context
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [this]() { return mActive == 0; });
+}
+
+void JobSystem::Execute()
+{
+    InsideJob = true;
+    while (true)
+    {
+        auto begin = mNext.fetch_add(mGrain, std::memory_order_relaxed);
+        if (begin >= mCount)
+        {
+            break;
+        }
+        mFunc(mContext, begin, std::min(begin + mGrain, mCount));
+    }
+    InsideJob = false;
+}
+
+void JobSystem::WorkerLoop(uint64_t generation)
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeCondition.wait(lock, [&]() { return mStop || mGeneration != generation; });
+            if (mStop)
+            {
+                return;
+            }
+            generation = mGeneration;
+        }
+
+        Execute();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (--mActive == 0)
+        {
+            mDoneCondition.notify_one();
+        }
+    }
+}
+
+void JobSystem::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWakeCondition.notify_all();
+
+    for (auto &worker : mWorkers)
+    {
+        worker.join();
+    }
+    mWorkers.clear();
+}
+} // namespace solis
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+#include "core/base/const.hpp"
+
+#include "core/base/i_noncopyable.hpp"
+
+namespace solis {
+/**
+ * @brief 固定数量的工作线程, 用于把一段下标区间分块并行地执行
+ * 调用ParallelFor的线程也会参与执行, 并且会等到所有的块都执行完才返回
+ *
+ * 同一时间只有一个ParallelFor在执行, 在工作线程中嵌套调用时直接在当前线程串行执行
+ * 每个块的划分只取决于count和grain, 所以只要每个块的结果只依赖自己的输入, 结果和线程数无关
+ */
+class SOLIS_CORE_API JobSystem : public Object<JobSystem>, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(JobSystem)
+
+    inline static JobSystem *Get()
+    {
+        static JobSystem instance;
+        return &instance;
+    }
+
+    /**
+     * @brief 默认的工作线程数量是硬件线程数减一, 调用线程也是一个执行者
+     */
+    JobSystem();
+    virtual ~JobSystem();
+
+    /**
+     * @brief 重新设置工作线程的数量, 0代表所有的任务都在调用线程中执行
+     * 不能在ParallelFor执行时调用
+     *
+     * @param count
+     */
+    void SetWorkerCount(uint32_t count);
+
+    /**
+     * @brief 当前线程是否正在执行ParallelFor的块
+     */
+    static bool IsInsideJob();
+
+    uint32_t GetWorkerCount() const
+    {
+        return static_cast<uint32_t>(mWorkers.size());
+    }
+
+    /**
+     * @brief 把[0, count)按grain分块, 并行地调用func(begin, end)
+     *
+     * @param count
+     * @param grain 每个块的大小
+     * @param func void(size_t begin, size_t end)
+     */
+    template <typename Func>
+    void ParallelFor(size_t count, size_t grain, Func &&func)
+    {
+        grain = std::max<size_t>(grain, 1);
+        if (count <= grain || mWorkers.empty() || IsInsideJob())
+        {
+            if (count > 0)
+            {
+                func(size_t(0), count);
+            }
+            return;
+        }
+
+        Dispatch(count, grain, &func, [](void *context, size_t begin, size_t end) {
+            (*static_cast<std::remove_reference_t<Func> *>(context))(begin, end);
+        });
+    }
+
+private:
+    using JobFunc = void (*)(void *context, size_t begin, size_t end);
+
+    void Dispatch(size_t count, size_t grain, void *context, JobFunc func);
+
+    /**
+     * @brief 不断地从当前任务中取块执行, 直到没有剩余的块
+     */
+    void Execute();
+
+    void WorkerLoop(uint64_t generation);
+
+    void StopWorkers();
+
+    vector<std::thread> mWorkers;
+
+    // 同一时间只有一个任务
+    std::mutex mDispatchMutex;
+
+    std::mutex              mMutex;
+    std::condition_variable mWakeCondition;
+    std::condition_variable mDoneCondition;
+    // 每发布一个任务递增, 工作线程用它判断是否有新的任务
+    uint64_t mGeneration = 0;
+    bool     mStop       = false;
+
+    // 当前任务
+    void               *mContext = nullptr;
+    JobFunc             mFunc    = nullptr;
+    size_t              mCount   = 0;
+    size_t              mGrain   = 1;
+    std::atomic<size_t> mNext{0};
+    // 还没有退出当前任务的工作线程数量
+    uint32_t mActive = 0;
+};
+} // namespace solis
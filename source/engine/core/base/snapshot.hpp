@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "core/solis_core.hpp"
+#include "core/base/using.hpp"
+
+namespace solis {
+/**
+ * @brief 二进制存档的写入器, 数据按本机字节序连续地写入内存
+ */
+class SnapshotWriter
+{
+public:
+    SnapshotWriter() = default;
+
+    void Write(const void *data, size_t size)
+    {
+        auto offset = mData.size();
+        mData.resize(offset + size);
+        std::memcpy(mData.data() + offset, data, size);
+    }
+
+    template <typename T>
+    void Write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "SnapshotWriter: T must be trivially copyable");
+        Write(&value, sizeof(T));
+    }
+
+    /**
+     * @brief 开始一个带标签和长度的块, 读取时不认识的块可以整块跳过
+     *
+     * @param tag
+     * @return size_t 传给EndBlock
+     */
+    size_t BeginBlock(uint64_t tag)
+    {
+        Write(tag);
+        auto offset = mData.size();
+        Write(uint64_t(0));
+        return offset;
+    }
+
+    void EndBlock(size_t offset)
+    {
+        uint64_t size = mData.size() - offset - sizeof(uint64_t);
+        std::memcpy(mData.data() + offset, &size, sizeof(size));
+    }
+
+    /**
+     * @brief 丢弃BeginBlock之后写入的所有数据, 包括块的标签
+     */
+    void CancelBlock(size_t offset)
+    {
+        mData.resize(offset - sizeof(uint64_t));
+    }
+
+    void Reserve(size_t size)
+    {
+        mData.reserve(size);
+    }
+
+    vector<uint8_t> &GetData()
+    {
+        return mData;
+    }
+
+private:
+    vector<uint8_t> mData;
+};
+
+/**
+ * @brief 二进制存档的读取器, 越界时返回false, 不会读出缓冲区
+ */
+class SnapshotReader
+{
+public:
+    SnapshotReader(const uint8_t *data, size_t size) :
+        mData(data), mSize(size)
+    {
+    }
+
+    bool Read(void *data, size_t size)
+    {
+        if (size > Remaining())
+        {
+            return false;
+        }
+        std::memcpy(data, mData + mOffset, size);
+        mOffset += size;
+        return true;
+    }
+
+    template <typename T>
+    bool Read(T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "SnapshotReader: T must be trivially copyable");
+        return Read(&value, sizeof(T));
+    }
+
+    /**
+     * @brief 读取一个SnapshotWriter::BeginBlock写入的块
+     *
+     * @param tag 输出块的标签
+     * @param block 输出只能读取块内数据的读取器, 无论块是否被读完, 当前读取器都会跳过整个块
+     * @return false 没有更多的块或者块不完整
+     */
+    bool ReadBlock(uint64_t &tag, SnapshotReader &block)
+    {
+        uint64_t size = 0;
+        if (!Read(tag) || !Read(size) || size > Remaining())
+        {
+            return false;
+        }
+
+        block = SnapshotReader(mData + mOffset, static_cast<size_t>(size));
+        mOffset += static_cast<size_t>(size);
+        return true;
+    }
+
+    bool Skip(size_t size)
+    {
+        if (size > Remaining())
+        {
+            return false;
+        }
+        mOffset += size;
+        return true;
+    }
+
+    size_t Remaining() const
+    {
+        return mSize - mOffset;
+    }
+
+    size_t Offset() const
+    {
+        return mOffset;
+    }
+
+private:
+    const uint8_t *mData   = nullptr;
+    size_t         mSize   = 0;
+    size_t         mOffset = 0;
+};
+
+/**
+ * @brief ObjectPool存档时每种类型的序列化方式
+ * 默认平凡可拷贝的类型直接memcpy, 其他类型需要特化这个模板:
+ *
+ * template <>
+ * struct SnapshotSerializer<Foo>
+ * {
+ *     static constexpr bool Enabled = true;
+ *     static void Write(SnapshotWriter &writer, const Foo &value);
+ *     // 在slot上构造一个Foo
+ *     static bool Read(SnapshotReader &reader, void *slot);
+ * };
+ */
+template <typename T>
+struct SnapshotSerializer
+{
+    static constexpr bool Enabled = std::is_trivially_copyable_v<T>;
+
+    static void Write(SnapshotWriter &writer, const T &value)
+    {
+        writer.Write(&value, sizeof(T));
+    }
+
+    static bool Read(SnapshotReader &reader, void *slot)
+    {
+        return reader.Read(slot, sizeof(T));
+    }
+};
+} // namespace solis
@@ -0,0 +1,275 @@
+#include "core/data/archetype.hpp"
+
+namespace solis {
+namespace {
+size_t AlignUp(size_t value, size_t align)
+{
+    return (value + align - 1) & ~(align - 1);
+}
+
+uint64_t SignatureHash(const vector<const ArchetypeComponentInfo *> &types)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (auto info : types)
+    {
+        hash ^= info->hash;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+} // namespace
+
+ArchetypeChunk::ArchetypeChunk(const Archetype &archetype) :
+    mOffsets(archetype.mOffsets.data()),
+    mAlign(archetype.mChunkAlign)
+{
+    mData = static_cast<uint8_t *>(ObjectBase::MallocAligned(archetype.mChunkBytes, std::align_val_t(archetype.mChunkAlign), "ArchetypeChunk::Data"));
+}
+
+ArchetypeChunk::~ArchetypeChunk()
+{
+    ObjectBase::FreeAligned(mData, std::align_val_t(mAlign));
+}
+
+Archetype::Archetype(vector<const ArchetypeComponentInfo *> &&types) :
+    mTypes(std::move(types))
+{
+    // 每一列都按Cache Line对齐, 方便连续读取和SIMD
+    const size_t columnAlign = 64;
+
+    size_t rowSize = sizeof(EntityID);
+    for (auto info : mTypes)
+    {
+        rowSize += info->size;
+        mChunkAlign = std::max(mChunkAlign, info->align);
+    }
+    mChunkAlign = std::max(mChunkAlign, columnAlign);
+
+    mChunkCapacity = static_cast<uint32_t>(std::max<size_t>(1, ArchetypeChunkSize / rowSize));
+
+    size_t offset = 0;
+    mOffsets.push_back(offset);
+    offset += sizeof(EntityID) * mChunkCapacity;
+    for (auto info : mTypes)
+    {
+        offset = AlignUp(offset, std::max(info->align, columnAlign));
+        mOffsets.push_back(offset);
+        offset += info->size * mChunkCapacity;
+    }
+    mChunkBytes = AlignUp(std::max<size_t>(offset, 1), mChunkAlign);
+}
+
+Archetype::~Archetype()
+{
+    for (size_t row = 0; row < mCount; ++row)
+    {
+        for (size_t i = 0; i < mTypes.size(); ++i)
+        {
+            mTypes[i]->destroy(At(row, i + 1));
+        }
+    }
+}
+
+size_t Archetype::PushRow(EntityID entity)
+{
+    if (mCount == mChunks.size() * mChunkCapacity)
+    {
+        mChunks.emplace_back(std::make_unique<ArchetypeChunk>(*this));
+    }
+
+    auto row      = mCount++;
+    EntityAt(row) = entity;
+    return row;
+}
+
+EntityID Archetype::PopRow(size_t row)
+{
+    assert(row < mCount);
+
+    EntityID moved;
+    auto     last = mCount - 1;
+    if (row != last)
+    {
+        for (size_t i = 0; i < mTypes.size(); ++i)
+        {
+            mTypes[i]->relocate(At(row, i + 1), At(last, i + 1));
+        }
+        moved         = EntityAt(last);
+        EntityAt(row) = moved;
+    }
+    mCount--;
+
+    // 多保留一个空的Chunk, 避免在边界上反复分配
+    auto needed = (mCount + mChunkCapacity - 1) / mChunkCapacity;
+    while (mChunks.size() > needed + 1)
+    {
+        mChunks.pop_back();
+    }
+    return moved;
+}
+
+ArchetypeStorage::ArchetypeStorage()
+{
+    // 空的Archetype
+    GetOrCreateArchetype({});
+}
+
+ArchetypeStorage::~ArchetypeStorage()
+{
+    mArchetypes.clear();
+}
+
+EntityID ArchetypeStorage::Create()
+{
+    assert(mIterating == 0 && "ArchetypeStorage: structural change while iterating");
+    return AllocRecord(*mArchetypes.front());
+}
+
+EntityID ArchetypeStorage::AllocRecord(Archetype &archetype)
+{
+    uint32_t index = 0;
+    if (mFreeHead != 0xFFFFFFFF)
+    {
+        index     = mFreeHead;
+        mFreeHead = mRecords[index].nextFree;
+    }
+    else
+    {
+        index = static_cast<uint32_t>(mRecords.size());
+        mRecords.emplace_back();
+    }
+
+    auto &record = mRecords[index];
+    // 奇数代表存活, 和ObjectPool的规则一样
+    record.generation++;
+    record.archetype = &archetype;
+
+    EntityID entity(index, record.generation);
+    record.row = archetype.PushRow(entity);
+    mCount++;
+    return entity;
+}
+
+bool ArchetypeStorage::Destroy(EntityID entity)
+{
+    assert(mIterating == 0 && "ArchetypeStorage: structural change while iterating");
+    if (!IsAlive(entity))
+    {
+        return false;
+    }
+
+    auto &record    = mRecords[entity.GetIndex()];
+    auto &archetype = *record.archetype;
+    auto &types     = archetype.GetTypes();
+    for (size_t i = 0; i < types.size(); ++i)
+    {
+        types[i]->destroy(archetype.At(record.row, i + 1));
+    }
+    RemoveRow(archetype, record.row);
+
+    record.generation++;
+    record.archetype = nullptr;
+    record.nextFree  = mFreeHead;
+    mFreeHead        = entity.GetIndex();
+    mCount--;
+    return true;
+}
+
+size_t ArchetypeStorage::MoveEntity(EntityID entity, Archetype &target)
+{
+    auto &record = mRecords[entity.GetIndex()];
+    auto &source = *record.archetype;
+    auto  oldRow = record.row;
+    auto  newRow = target.PushRow(entity);
+
+    auto &types = source.GetTypes();
+    for (size_t i = 0; i < types.size(); ++i)
+    {
+        auto column = target.ColumnOf(types[i]->hash);
+        if (column >= 0)
+        {
+            types[i]->relocate(target.At(newRow, column), source.At(oldRow, i + 1));
+        }
+        else
+        {
+            types[i]->destroy(source.At(oldRow, i + 1));
+        }
+    }
+    RemoveRow(source, oldRow);
+
+    record.archetype = &target;
+    record.row       = newRow;
+    return newRow;
+}
+
+void ArchetypeStorage::RemoveRow(Archetype &archetype, size_t row)
+{
+    auto moved = archetype.PopRow(row);
+    if (moved.IsValid())
+    {
+        mRecords[moved.GetIndex()].row = row;
+    }
+}
+
+Archetype *ArchetypeStorage::GetAddEdge(Archetype &archetype, const ArchetypeComponentInfo *info)
+{
+    auto it = archetype.mAddEdges.find(info->hash);
+    if (it != archetype.mAddEdges.end())
+    {
+        return it->second;
+    }
+
+    auto types = archetype.GetTypes();
+    types.push_back(info);
+
+    auto target                      = GetOrCreateArchetype(std::move(types));
+    archetype.mAddEdges[info->hash]  = target;
+    target->mRemoveEdges[info->hash] = &archetype;
+    return target;
+}
+
+Archetype *ArchetypeStorage::GetRemoveEdge(Archetype &archetype, const ArchetypeComponentInfo *info)
+{
+    auto it = archetype.mRemoveEdges.find(info->hash);
+    if (it != archetype.mRemoveEdges.end())
+    {
+        return it->second;
+    }
+
+    vector<const ArchetypeComponentInfo *> types;
+    for (auto type : archetype.GetTypes())
+    {
+        if (type != info)
+        {
+            types.push_back(type);
+        }
+    }
+
+    auto target                        = GetOrCreateArchetype(std::move(types));
+    archetype.mRemoveEdges[info->hash] = target;
+    target->mAddEdges[info->hash]      = &archetype;
+    return target;
+}
+
+Archetype *ArchetypeStorage::GetOrCreateArchetype(vector<const ArchetypeComponentInfo *> &&types)
+{
+    std::sort(types.begin(), types.end(), [](const ArchetypeComponentInfo *a, const ArchetypeComponentInfo *b) {
+        return a->hash < b->hash;
+    });
+    assert(std::adjacent_find(types.begin(), types.end()) == types.end() && "ArchetypeStorage: duplicate component type");
+
+    auto &bucket = mArchetypeMap[SignatureHash(types)];
+    for (auto archetype : bucket)
+    {
+        if (archetype->GetTypes() == types)
+        {
+            return archetype;
+        }
+    }
+
+    mArchetypes.emplace_back(std::make_unique<Archetype>(std::move(types)));
+    bucket.push_back(mArchetypes.back().get());
+    return mArchetypes.back().get();
+}
+} // namespace solis
@@ -0,0 +1,438 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+#include "core/base/const.hpp"
+
+#include "core/base/ecs.hpp"
+#include "core/base/i_noncopyable.hpp"
+
+#include "ctti/type_id.hpp"
+
+namespace solis {
+
+/**
+ * @brief 存储在Archetype中的组件类型的信息, 用于类型擦除的移动和析构
+ * 这里的组件是纯数据的组件(需要可以移动), 和Component<T>不同, 它们按列连续存储
+ */
+struct SOLIS_CORE_API ArchetypeComponentInfo
+{
+    uint64_t hash  = 0;
+    size_t   size  = 0;
+    size_t   align = 0;
+
+    // 在dst上移动构造src, 然后析构src
+    void (*relocate)(void *dst, void *src) = nullptr;
+    void (*destroy)(void *ptr)             = nullptr;
+
+    template <typename T>
+    static const ArchetypeComponentInfo *Of()
+    {
+        static_assert(std::is_move_constructible_v<T>, "Archetype component must be move constructible");
+
+        static const ArchetypeComponentInfo info{
+            ctti::type_id<T>().hash(),
+            sizeof(T),
+            alignof(T),
+            [](void *dst, void *src) {
+                ::new (dst) T(std::move(*static_cast<T *>(src)));
+                static_cast<T *>(src)->~T();
+            },
+            [](void *ptr) { static_cast<T *>(ptr)->~T(); },
+        };
+        return &info;
+    }
+};
+
+class Archetype;
+
+/**
+ * @brief 一个Chunk是一块连续的内存, 按列(SoA)存放同一个Archetype的若干行
+ * 第一列固定是EntityID, 之后是按类型hash排序的组件列
+ */
+class SOLIS_CORE_API ArchetypeChunk : public Object<ArchetypeChunk>, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(ArchetypeChunk)
+
+    ArchetypeChunk(const Archetype &archetype);
+    ~ArchetypeChunk();
+
+    uint8_t *Column(size_t column) const
+    {
+        return mData + mOffsets[column];
+    }
+
+    EntityID *Entities() const
+    {
+        return reinterpret_cast<EntityID *>(mData);
+    }
+
+private:
+    uint8_t      *mData = nullptr;
+    const size_t *mOffsets;
+    size_t        mAlign;
+};
+
+/**
+ * @brief 拥有相同组件集合的Entity都存放在同一个Archetype中
+ * 行是紧密排列的, 删除时用最后一行填补空洞
+ */
+class SOLIS_CORE_API Archetype : public Object<Archetype>, public INonCopyable
+{
+    friend class ArchetypeChunk;
+    friend class ArchetypeStorage;
+
+public:
+    OBJECT_NEW_DELETE(Archetype)
+
+    Archetype(vector<const ArchetypeComponentInfo *> &&types);
+    ~Archetype();
+
+    /**
+     * @brief 组件类型在这个Archetype中的列下标
+     *
+     * @param hash
+     * @return int, 不存在返回-1
+     */
+    int ColumnOf(uint64_t hash) const
+    {
+        auto it = std::lower_bound(mTypes.begin(), mTypes.end(), hash, [](const ArchetypeComponentInfo *info, uint64_t h) {
+            return info->hash < h;
+        });
+        if (it == mTypes.end() || (*it)->hash != hash)
+        {
+            return -1;
+        }
+        // 第0列是EntityID
+        return static_cast<int>(it - mTypes.begin()) + 1;
+    }
+
+    bool Has(uint64_t hash) const
+    {
+        return ColumnOf(hash) >= 0;
+    }
+
+    const vector<const ArchetypeComponentInfo *> &GetTypes() const
+    {
+        return mTypes;
+    }
+
+    size_t Count() const
+    {
+        return mCount;
+    }
+
+    uint32_t ChunkCapacity() const
+    {
+        return mChunkCapacity;
+    }
+
+    size_t ChunkCount() const
+    {
+        return mChunks.size();
+    }
+
+    ArchetypeChunk &GetChunk(size_t index) const
+    {
+        return *mChunks[index];
+    }
+
+    /**
+     * @brief 第index个Chunk中有效的行数
+     */
+    uint32_t ChunkRows(size_t index) const
+    {
+        auto begin = index * mChunkCapacity;
+        if (begin >= mCount)
+        {
+            return 0;
+        }
+        return static_cast<uint32_t>(std::min<size_t>(mChunkCapacity, mCount - begin));
+    }
+
+    void *At(size_t row, size_t column) const
+    {
+        auto &chunk = *mChunks[row / mChunkCapacity];
+        auto  size  = column == 0 ? sizeof(EntityID) : mTypes[column - 1]->size;
+        return chunk.Column(column) + (row % mChunkCapacity) * size;
+    }
+
+    EntityID &EntityAt(size_t row) const
+    {
+        return *static_cast<EntityID *>(At(row, 0));
+    }
+
+private:
+    /**
+     * @brief 在末尾分配一行, 组件列未初始化
+     */
+    size_t PushRow(EntityID entity);
+
+    /**
+     * @brief 删除一行, 组件列需要已经被析构或者移走, 会用最后一行填补
+     *
+     * @return EntityID 被移动到row上的Entity, 如果没有移动则返回无效的ID
+     */
+    EntityID PopRow(size_t row);
+
+    vector<const ArchetypeComponentInfo *> mTypes;
+    // 每一列在Chunk中的偏移, 第0列是EntityID
+    vector<size_t> mOffsets;
+    size_t         mChunkBytes    = 0;
+    size_t         mChunkAlign    = alignof(EntityID);
+    uint32_t       mChunkCapacity = 0;
+
+    vector<std::unique_ptr<ArchetypeChunk>> mChunks;
+    size_t                                  mCount = 0;
+
+    // 添加/删除一个组件之后到达的Archetype
+    dict_map<uint64_t, Archetype *> mAddEdges;
+    dict_map<uint64_t, Archetype *> mRemoveEdges;
+};
+
+/**
+ * @brief Archetype(SoA)存储, 按组件集合对Entity进行分组
+ *
+ * Each<A, B>(func) 只会访问同时拥有A和B的Archetype, 并且在Chunk中线性地遍历每一列
+ * func 可以是 void(A &, B &) 或者 void(EntityID, A &, B &)
+ */
+class SOLIS_CORE_API ArchetypeStorage : public Object<ArchetypeStorage>, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(ArchetypeStorage)
+
+    ArchetypeStorage();
+    ~ArchetypeStorage();
+
+    /**
+     * @brief 创建一个没有任何组件的Entity
+     */
+    EntityID Create();
+
+    /**
+     * @brief 创建一个Entity并直接放入到对应的Archetype中, 不经过中间的Archetype
+     */
+    template <typename... Ts>
+    EntityID Create(Ts &&...components)
+    {
+        assert(mIterating == 0 && "ArchetypeStorage: structural change while iterating");
+
+        vector<const ArchetypeComponentInfo *> types{ArchetypeComponentInfo::Of<std::decay_t<Ts>>()...};
+        auto archetype = GetOrCreateArchetype(std::move(types));
+        auto entity    = AllocRecord(*archetype);
+        auto row       = mRecords[entity.GetIndex()].row;
+
+        (::new (archetype->At(row, archetype->ColumnOf(ctti::type_id<std::decay_t<Ts>>().hash()))) std::decay_t<Ts>(std::forward<Ts>(components)), ...);
+        return entity;
+    }
+
+    /**
+     * @brief 销毁Entity和它所有的组件
+     *
+     * @return false 如果Entity已经失效
+     */
+    bool Destroy(EntityID entity);
+
+    bool IsAlive(EntityID entity) const
+    {
+        auto index = entity.GetIndex();
+        return entity.IsValid() && index < mRecords.size() && mRecords[index].generation == entity.GetGeneration();
+    }
+
+    template <typename T, typename... Args>
+    T *Add(EntityID entity, Args &&...args)
+    {
+        assert(mIterating == 0 && "ArchetypeStorage: structural change while iterating");
+        if (!IsAlive(entity))
+        {
+            return nullptr;
+        }
+
+        auto  info   = ArchetypeComponentInfo::Of<T>();
+        auto &record = mRecords[entity.GetIndex()];
+
+        auto column = record.archetype->ColumnOf(info->hash);
+        if (column >= 0)
+        {
+            // 已经存在就直接替换
+            auto ptr = static_cast<T *>(record.archetype->At(record.row, column));
+            ptr->~T();
+            return ::new (ptr) T(std::forward<Args>(args)...);
+        }
+
+        auto target = GetAddEdge(*record.archetype, info);
+        auto row    = MoveEntity(entity, *target);
+
+        auto ptr = record.archetype->At(row, target->ColumnOf(info->hash));
+        return ::new (ptr) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    bool Remove(EntityID entity)
+    {
+        assert(mIterating == 0 && "ArchetypeStorage: structural change while iterating");
+        if (!IsAlive(entity))
+        {
+            return false;
+        }
+
+        auto  info   = ArchetypeComponentInfo::Of<T>();
+        auto &record = mRecords[entity.GetIndex()];
+        if (!record.archetype->Has(info->hash))
+        {
+            return false;
+        }
+
+        MoveEntity(entity, *GetRemoveEdge(*record.archetype, info));
+        return true;
+    }
+
+    template <typename T>
+    T *Get(EntityID entity) const
+    {
+        if (!IsAlive(entity))
+        {
+            return nullptr;
+        }
+
+        auto &record = mRecords[entity.GetIndex()];
+        auto  column = record.archetype->ColumnOf(ctti::type_id<T>().hash());
+        if (column < 0)
+        {
+            return nullptr;
+        }
+        return static_cast<T *>(record.archetype->At(record.row, column));
+    }
+
+    template <typename T>
+    bool Has(EntityID entity) const
+    {
+        return Get<T>(entity) != nullptr;
+    }
+
+    /**
+     * @brief 按Chunk遍历, func(uint32_t count, EntityID *entities, Ts *...columns)
+     * 每一列都是连续的数组, 适合批量或者SIMD处理
+     */
+    template <typename... Ts, typename Func>
+    void EachChunk(Func &&func)
+    {
+        const uint64_t hashes[] = {ctti::type_id<std::decay_t<Ts>>().hash()..., 0};
+
+        mIterating++;
+        for (auto &archetype : mArchetypes)
+        {
+            if (archetype->Count() == 0)
+            {
+                continue;
+            }
+
+            int  columns[sizeof...(Ts) + 1] = {};
+            bool matched                    = true;
+            for (size_t i = 0; i < sizeof...(Ts); ++i)
+            {
+                columns[i] = archetype->ColumnOf(hashes[i]);
+                matched    = matched && columns[i] >= 0;
+            }
+            if (!matched)
+            {
+                continue;
+            }
+
+            for (size_t c = 0; c < archetype->ChunkCount(); ++c)
+            {
+                auto &chunk = archetype->GetChunk(c);
+                auto  rows  = archetype->ChunkRows(c);
+                if (rows == 0)
+                {
+                    break;
+                }
+                [&]<size_t... I>(std::index_sequence<I...>) {
+                    func(rows, chunk.Entities(), reinterpret_cast<std::decay_t<Ts> *>(chunk.Column(columns[I]))...);
+                }(std::index_sequence_for<Ts...>{});
+            }
+        }
+        mIterating--;
+    }
+
+    /**
+     * @brief 遍历所有同时拥有Ts...的Entity
+     */
+    template <typename... Ts, typename Func>
+    void Each(Func &&func)
+    {
+        EachChunk<Ts...>([&](uint32_t count, EntityID *entities, std::decay_t<Ts> *...columns) {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if constexpr (std::is_invocable_v<Func, EntityID, Ts &...>)
+                {
+                    func(entities[i], columns[i]...);
+                }
+                else
+                {
+                    func(columns[i]...);
+                }
+            }
+        });
+    }
+
+    size_t Count() const
+    {
+        return mCount;
+    }
+
+    size_t ArchetypeCount() const
+    {
+        return mArchetypes.size();
+    }
+
+private:
+    struct EntityRecord
+    {
+        Archetype *archetype  = nullptr;
+        size_t     row        = 0;
+        uint32_t   generation = 0;
+        // 空闲链表
+        uint32_t nextFree = 0xFFFFFFFF;
+    };
+
+    /**
+     * @brief 分配一个Entity记录并在archetype末尾为它分配一行
+     */
+    EntityID AllocRecord(Archetype &archetype);
+
+    /**
+     * @brief 把Entity移动到target中, 两者共有的组件会被移动, 多余的组件会被析构
+     *
+     * @return size_t Entity在target中的行
+     */
+    size_t MoveEntity(EntityID entity, Archetype &target);
+
+    /**
+     * @brief 从行中删除Entity, 并修正被移动过来填补空洞的Entity的记录
+     */
+    void RemoveRow(Archetype &archetype, size_t row);
+
+    Archetype *GetAddEdge(Archetype &archetype, const ArchetypeComponentInfo *info);
+    Archetype *GetRemoveEdge(Archetype &archetype, const ArchetypeComponentInfo *info);
+    Archetype *GetOrCreateArchetype(vector<const ArchetypeComponentInfo *> &&types);
+
+    vector<std::unique_ptr<Archetype>> mArchetypes;
+    // 组件集合的hash -> Archetype, 同一个hash下可能有多个
+    dict_map<uint64_t, vector<Archetype *>> mArchetypeMap;
+
+    vector<EntityRecord> mRecords;
+    uint32_t             mFreeHead  = 0xFFFFFFFF;
+    size_t               mCount     = 0;
+    uint32_t             mIterating = 0;
+};
+} // namespace solis
@@ -1 +1,15 @@
-#include "core/data/component.hpp"
\ No newline at end of file
+#include "core/data/component.hpp"
+
+#include <atomic>
+#include <cassert>
+
+namespace solis {
+uint32_t ComponentBase::NextTypeIndex()
+{
+    static std::atomic<uint32_t> counter{0};
+
+    auto index = counter.fetch_add(1, std::memory_order_relaxed);
+    assert(index < MaxComponentTypes && "ComponentBase: too many component types");
+    return index;
+}
+} // namespace solis
@@ -18,6 +18,12 @@ public:
     virtual ~ComponentBase() = default;
 
     virtual uint64_t GetTypeId() = 0;
+
+protected:
+    /**
+     * @brief 分配下一个稠密的组件类型下标
+     */
+    static uint32_t NextTypeIndex();
 };
 
 class GameObject;
@@ -26,6 +32,7 @@ template <typename T>
 class Component : public ComponentBase
 {
     friend class ObjectPool<T>;
+    friend struct SnapshotSerializer<T>;
 
 public:
     Component() = default;
@@ -43,7 +50,7 @@ public:
             return;
         }
         OnDestroy();
-        GetPool().FreeEntity(mEntityID);
+        GetPool().FreeEntityConcurrent(mEntityID);
     }
 
     virtual uint64_t GetTypeId() override
@@ -51,20 +58,59 @@ public:
         return ctti::type_id<T>().hash();
     }
 
+    /**
+     * @brief 稠密的组件类型下标, 在 [0, MaxComponentTypes) 中, 每种组件第一次使用时分配
+     * GameObject用它来做位掩码和组件数组的下标
+     */
+    inline static uint32_t TypeIndex()
+    {
+        static const uint32_t index = NextTypeIndex();
+        return index;
+    }
+
     inline static ObjectPool<T> &GetPool()
     {
         static ObjectPool<T> pool;
         return pool;
     }
 
+    /**
+     * @brief 分配一个组件, 线程安全, 工作线程可以并行地创建组件
+     */
     inline static T *Get()
     {
         EntityID id;
-        auto     entity   = GetPool().AllocEntity(&id);
+        auto     entity   = GetPool().AllocEntityConcurrent(&id);
         entity->mEntityID = id;
         return entity;
     }
 
+    /**
+     * @brief 批量分配count个组件, 只预留一次组件池, 线程安全
+     *
+     * @param count
+     * @param components 输出count个组件
+     * @param prototype 不为空时每个组件从它复制, 可平凡复制的组件直接memcpy
+     */
+    inline static void Get(size_t count, T **components, const T *prototype = nullptr)
+    {
+        vector<EntityID> ids(count);
+        GetPool().AllocEntities(count, ids.data(), components, prototype);
+        for (size_t i = 0; i < count; ++i)
+        {
+            components[i]->mEntityID = ids[i];
+        }
+    }
+
+    /**
+     * @brief 标记组件被修改了, 只会记录到组件所在的节点上
+     * 系统通过GetPool().ForEachChanged跳过没有被修改过的节点
+     */
+    void MarkChanged()
+    {
+        GetPool().MarkChanged(mEntityID);
+    }
+
     EntityID mEntityID;
 
 protected:
@@ -89,6 +135,4 @@ protected:
      */
     virtual void OnRemove(GameObject *gameObject){};
 };
-
-using ComponentMap = dict_map<uint64_t, ComponentBase *>;
 } // namespace solis
\ No newline at end of file
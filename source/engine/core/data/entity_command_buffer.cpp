@@ -0,0 +1,288 @@
+#include "core/data/entity_command_buffer.hpp"
+
+#include <algorithm>
+
+namespace solis {
+// 回调内存块的大小
+static const size_t CommandBlockSize = 4 * 1024;
+
+static std::byte *AlignUp(std::byte *ptr, size_t align)
+{
+    return reinterpret_cast<std::byte *>((reinterpret_cast<uintptr_t>(ptr) + align - 1) & ~(uintptr_t(align) - 1));
+}
+
+/**
+ * @brief 当前线程的存活标记, 线程退出时析构, 超出编号的线程的缓冲区用它判断主人是否已经退出
+ */
+static const std::shared_ptr<const bool> &ThreadAlive()
+{
+    thread_local auto alive = std::make_shared<const bool>(true);
+    return alive;
+}
+
+EntityCommandBuffer::~EntityCommandBuffer()
+{
+    Clear();
+
+    for (auto &slot : mThreadBuffers)
+    {
+        delete slot.load(std::memory_order_relaxed);
+    }
+}
+
+void EntityCommandBuffer::Destroy(Entity entity)
+{
+    auto &command   = Record(Kind::Destroy, 0, entity);
+    command.execute = [](EntityCommandBuffer &buffer, Command &command) {
+        delete buffer.Resolve(command.entity);
+        if (command.entity.IsDeferred())
+        {
+            buffer.mCreated[command.entity.mDeferred] = nullptr;
+        }
+    };
+}
+
+void EntityCommandBuffer::Playback()
+{
+    struct CommandRef
+    {
+        Kind     kind;
+        uint64_t type;
+        Command *command;
+    };
+
+    struct Recorded
+    {
+        ThreadBuffer *owner;
+        ThreadBuffer  buffer;
+    };
+
+    // 先把所有线程的命令和回调内存换出来, 执行时新记录的命令进入空的列表, 不会让这里的指针失效
+    vector<Recorded> recorded;
+    size_t           count = 0;
+    ForEachThreadBuffer([&](ThreadBuffer &threadBuffer) {
+        if (threadBuffer.commands.empty())
+        {
+            return;
+        }
+
+        auto &swapped = recorded.emplace_back();
+        swapped.owner = &threadBuffer;
+        swapped.buffer.commands.swap(threadBuffer.commands);
+        swapped.buffer.blocks.swap(threadBuffer.blocks);
+        swapped.buffer.largeBlocks.swap(threadBuffer.largeBlocks);
+        threadBuffer.blockOffset = 0;
+        count += swapped.buffer.commands.size();
+    });
+
+    if (recorded.empty())
+    {
+        return;
+    }
+
+    vector<CommandRef> refs;
+    refs.reserve(count);
+    for (auto &swapped : recorded)
+    {
+        for (auto &command : swapped.buffer.commands)
+        {
+            refs.push_back({command.kind, command.type, &command});
+        }
+    }
+
+    // 稳定排序, 同一个线程中同一种命令的记录顺序不变
+    std::stable_sort(refs.begin(), refs.end(), [](const CommandRef &lhs, const CommandRef &rhs) {
+        return lhs.kind != rhs.kind ? lhs.kind < rhs.kind : lhs.type < rhs.type;
+    });
+
+    // 每个延迟对象都对应一个创建命令, 先全部创建出来, 创建命令排在最前面, 它们的回调留到最后调用
+    // 执行时新创建的延迟对象从0重新编号, 属于下一次回放
+    mCreated.resize(mDeferredCount.exchange(0, std::memory_order_relaxed));
+    for (auto &gameObject : mCreated)
+    {
+        gameObject = new GameObject();
+    }
+    size_t creates = 0;
+    while (creates < refs.size() && refs[creates].kind == Kind::Create)
+    {
+        creates++;
+    }
+
+    vector<Command *> batch;
+    for (size_t i = creates; i < refs.size();)
+    {
+        auto command = refs[i].command;
+        if (command->batch == nullptr)
+        {
+            command->execute(*this, *command);
+            i++;
+            continue;
+        }
+
+        batch.clear();
+        for (; i < refs.size() && refs[i].command->batch == command->batch; ++i)
+        {
+            batch.push_back(refs[i].command);
+        }
+        command->batch(*this, batch.data(), batch.size());
+    }
+
+    for (size_t i = 0; i < creates; ++i)
+    {
+        auto command = refs[i].command;
+        if (mCreated[command->entity.mDeferred] != nullptr)
+        {
+            command->execute(*this, *command);
+        }
+    }
+    mCreated.clear();
+
+    for (auto &swapped : recorded)
+    {
+        for (auto &command : swapped.buffer.commands)
+        {
+            if (command.release != nullptr)
+            {
+                command.release(command);
+            }
+        }
+
+        // 执行时没有新记录命令的线程缓冲区拿回命令列表的容量和一块回调内存, 稳定之后不再分配内存
+        auto owner = swapped.owner;
+        if (owner->commands.empty())
+        {
+            swapped.buffer.commands.clear();
+            owner->commands.swap(swapped.buffer.commands);
+        }
+        if (owner->blocks.empty() && !swapped.buffer.blocks.empty())
+        {
+            owner->blocks.push_back(std::move(swapped.buffer.blocks.front()));
+        }
+    }
+}
+
+size_t EntityCommandBuffer::Count() const
+{
+    size_t count = 0;
+    ForEachThreadBuffer([&](ThreadBuffer &threadBuffer) {
+        count += threadBuffer.commands.size();
+    });
+    return count;
+}
+
+EntityCommandBuffer::Command &EntityCommandBuffer::Record(Kind kind, uint64_t type, Entity entity)
+{
+    auto &command  = GetThreadBuffer().commands.emplace_back();
+    command.kind   = kind;
+    command.type   = type;
+    command.entity = entity;
+    return command;
+}
+
+void *EntityCommandBuffer::Allocate(size_t size, size_t align)
+{
+    auto &threadBuffer = GetThreadBuffer();
+
+    // 太大的回调单独分配一块
+    if (size + align > CommandBlockSize)
+    {
+        auto &block = threadBuffer.largeBlocks.emplace_back(std::make_unique<std::byte[]>(size + align));
+        return AlignUp(block.get(), align);
+    }
+
+    // 块只保证基本的对齐, 所以对齐实际的地址而不是块内的偏移
+    if (!threadBuffer.blocks.empty())
+    {
+        auto begin = threadBuffer.blocks.back().get();
+        auto ptr   = AlignUp(begin + threadBuffer.blockOffset, align);
+        if (ptr + size <= begin + CommandBlockSize)
+        {
+            threadBuffer.blockOffset = ptr + size - begin;
+            return ptr;
+        }
+    }
+
+    // size + align不超过一块, 新块中对齐之后一定放得下
+    auto begin               = threadBuffer.blocks.emplace_back(std::make_unique<std::byte[]>(CommandBlockSize)).get();
+    auto ptr                 = AlignUp(begin, align);
+    threadBuffer.blockOffset = ptr + size - begin;
+    return ptr;
+}
+
+EntityCommandBuffer::ThreadBuffer &EntityCommandBuffer::GetThreadBuffer()
+{
+    auto threadIndex = ObjectPoolBase::ThreadIndex();
+    if (threadIndex >= ObjectPoolMaxThreads)
+    {
+        // 缓冲区在堆上, 找到之后这个线程独占使用, 不需要继续持有锁
+        std::lock_guard<std::mutex> lock(mOverflowMutex);
+
+        auto           &alive    = ThreadAlive();
+        OverflowBuffer *reusable = nullptr;
+        for (auto &overflow : mOverflowBuffers)
+        {
+            auto owner = overflow.owner.lock();
+            if (owner == alive)
+            {
+                return *overflow.buffer;
+            }
+            if (owner == nullptr && reusable == nullptr)
+            {
+                reusable = &overflow;
+            }
+        }
+
+        // 主人已经退出的缓冲区连同还没有回放的命令一起交给这个线程
+        if (reusable == nullptr)
+        {
+            reusable         = &mOverflowBuffers.emplace_back();
+            reusable->buffer = std::make_unique<ThreadBuffer>();
+        }
+        reusable->owner = alive;
+        return *reusable->buffer;
+    }
+
+    // 每个线程只会创建自己的缓冲区, 线程退出之后编号和缓冲区一起被下一个线程继承
+    auto &slot         = mThreadBuffers[threadIndex];
+    auto  threadBuffer = slot.load(std::memory_order_relaxed);
+    if (threadBuffer == nullptr)
+    {
+        threadBuffer = new ThreadBuffer();
+        slot.store(threadBuffer, std::memory_order_release);
+    }
+    return *threadBuffer;
+}
+
+GameObject *EntityCommandBuffer::Resolve(const Entity &entity)
+{
+    if (!entity.IsDeferred())
+    {
+        return entity.mGameObject;
+    }
+
+    assert(entity.mDeferred < mCreated.size() && mCreated[entity.mDeferred] != nullptr);
+    return mCreated[entity.mDeferred];
+}
+
+void EntityCommandBuffer::Clear()
+{
+    ForEachThreadBuffer([&](ThreadBuffer &threadBuffer) {
+        for (auto &command : threadBuffer.commands)
+        {
+            if (command.release != nullptr)
+            {
+                command.release(command);
+            }
+        }
+
+        // 保留容量给下一帧使用
+        threadBuffer.commands.clear();
+        threadBuffer.blocks.resize(std::min<size_t>(threadBuffer.blocks.size(), 1));
+        threadBuffer.largeBlocks.clear();
+        threadBuffer.blockOffset = 0;
+    });
+
+    mCreated.clear();
+    mDeferredCount.store(0, std::memory_order_relaxed);
+}
+} // namespace solis
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+#include "core/base/const.hpp"
+
+#include "core/base/ecs.hpp"
+#include "core/base/i_noncopyable.hpp"
+#include "core/data/component.hpp"
+#include "core/data/game_object.hpp"
+
+#include "ctti/type_id.hpp"
+
+namespace solis {
+
+/**
+ * @brief 延迟执行的结构性修改(创建/销毁GameObject, 添加/移除/销毁组件)
+ * 可以在任意线程中记录, 每个线程写自己的缓冲区, 不需要加锁
+ * 在Engine::Step的同步点上由主线程统一回放:
+ * 命令按 (类型, 组件类型) 稳定排序后执行, 同一种组件的池操作连续地批量完成
+ *
+ * 回放顺序: 创建GameObject -> 添加组件 -> 移除组件 -> 销毁组件 -> 销毁GameObject -> 创建回调
+ * 同一帧内对同一个对象先移除再添加同一种组件会被重排, 这种情况需要分两帧记录
+ */
+class SOLIS_CORE_API EntityCommandBuffer : public Object<EntityCommandBuffer>, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(EntityCommandBuffer)
+
+    /**
+     * @brief 命令的目标, 可以是已经存在的GameObject, 也可以是同一个缓冲区中延迟创建的GameObject
+     */
+    class Entity
+    {
+    public:
+        explicit Entity(GameObject *gameObject) :
+            mGameObject(gameObject)
+        {
+            assert(gameObject != nullptr && "EntityCommandBuffer::Entity: use Create() for deferred game objects");
+        }
+
+        bool IsDeferred() const
+        {
+            return mGameObject == nullptr;
+        }
+
+    private:
+        friend class EntityCommandBuffer;
+
+        // 没有目标的命令, 例如销毁组件
+        Entity() = default;
+
+        explicit Entity(uint32_t deferred) :
+            mDeferred(deferred)
+        {
+        }
+
+        GameObject *mGameObject = nullptr;
+        uint32_t    mDeferred   = 0;
+    };
+
+    EntityCommandBuffer() = default;
+    virtual ~EntityCommandBuffer();
+
+    /**
+     * @brief 延迟创建一个GameObject, 回放结束之后把它交给created, 调用者负责之后销毁它
+     * 在同一次回放中被销毁的对象不会调用created
+     *
+     * @param created 在同一次回放的所有命令执行之后调用, void(GameObject *), 这时组件已经添加好了
+     * @return Entity 可以作为同一个缓冲区中其他命令的目标
+     */
+    template <typename Func>
+    Entity Create(Func &&created)
+    {
+        using Created = std::decay_t<Func>;
+
+        auto  entity    = Entity(mDeferredCount.fetch_add(1, std::memory_order_relaxed));
+        auto &command   = Record(Kind::Create, 0, entity);
+        command.payload = ::new (Allocate(sizeof(Created), alignof(Created))) Created(std::forward<Func>(created));
+        command.execute = [](EntityCommandBuffer &buffer, Command &command) {
+            (*static_cast<Created *>(command.payload))(buffer.Resolve(command.entity));
+        };
+        command.release = [](Command &command) {
+            static_cast<Created *>(command.payload)->~Created();
+        };
+        return entity;
+    }
+
+    /**
+     * @brief 延迟销毁一个GameObject, 组件需要单独销毁
+     */
+    void Destroy(Entity entity);
+
+    /**
+     * @brief 延迟添加一个使用内置组件池的组件
+     *
+     * @tparam T
+     * @param entity
+     * @param init 回放时在组件添加之后调用, void(T &)
+     */
+    template <typename T, typename Func = void (*)(T &)>
+    std::enable_if_t<std::is_base_of_v<Component<T>, T>, void>
+    AddComponent(Entity entity, Func &&init = nullptr)
+    {
+        using Init = std::decay_t<Func>;
+
+        auto &command = Record(Kind::AddComponent, ctti::type_id<T>().hash(), entity);
+        if constexpr (std::is_same_v<Init, void (*)(T &)>)
+        {
+            command.payload = reinterpret_cast<void *>(init);
+            command.batch   = [](EntityCommandBuffer &buffer, Command *const *commands, size_t count) {
+                buffer.AddComponents<T>(commands, count, [](Command &command, T &component) {
+                    if (command.payload != nullptr)
+                    {
+                        reinterpret_cast<void (*)(T &)>(command.payload)(component);
+                    }
+                });
+            };
+        }
+        else
+        {
+            command.payload = ::new (Allocate(sizeof(Init), alignof(Init))) Init(std::forward<Func>(init));
+            command.batch   = [](EntityCommandBuffer &buffer, Command *const *commands, size_t count) {
+                buffer.AddComponents<T>(commands, count, [](Command &command, T &component) {
+                    (*static_cast<Init *>(command.payload))(component);
+                });
+            };
+            command.release = [](Command &command) {
+                static_cast<Init *>(command.payload)->~Init();
+            };
+        }
+    }
+
+    /**
+     * @brief 延迟添加一个外部管理的组件
+     */
+    template <typename T>
+    std::enable_if_t<std::is_base_of_v<Component<T>, T>, void>
+    AddComponent(Entity entity, T *component)
+    {
+        auto &command   = Record(Kind::AddComponent, ctti::type_id<T>().hash(), entity);
+        command.payload = component;
+        command.execute = [](EntityCommandBuffer &buffer, Command &command) {
+            buffer.Resolve(command.entity)->AddComponent(static_cast<T *>(command.payload));
+        };
+    }
+
+    /**
+     * @brief 延迟从GameObject中移除组件
+     */
+    template <typename T>
+    std::enable_if_t<std::is_base_of_v<Component<T>, T>, void>
+    RemoveComponent(Entity entity)
+    {
+        auto &command   = Record(Kind::RemoveComponent, ctti::type_id<T>().hash(), entity);
+        command.execute = [](EntityCommandBuffer &buffer, Command &command) {
+            buffer.Resolve(command.entity)->RemoveComponent<T>();
+        };
+    }
+
+    /**
+     * @brief 延迟销毁组件, 组件回到内置组件池
+     */
+    template <typename T>
+    std::enable_if_t<std::is_base_of_v<Component<T>, T>, void>
+    Destroy(T *component)
+    {
+        auto &command   = Record(Kind::DestroyComponent, ctti::type_id<T>().hash(), Entity());
+        command.payload = component;
+        command.execute = [](EntityCommandBuffer &buffer, Command &command) {
+            static_cast<T *>(command.payload)->Destroy();
+        };
+    }
+
+    /**
+     * @brief 在主线程的同步点上回放所有记录的命令, 然后清空缓冲区
+     * 回放时不能有其他线程在记录命令, 命令执行时(例如组件的初始化回调中)记录的命令留到下一次回放
+     */
+    void Playback();
+
+    /**
+     * @brief 还没有回放的命令数量
+     */
+    size_t Count() const;
+
+private:
+    enum class Kind : uint8_t
+    {
+        Create,
+        AddComponent,
+        RemoveComponent,
+        DestroyComponent,
+        Destroy,
+    };
+
+    struct Command
+    {
+        Kind     kind = Kind::Create;
+        uint64_t type = 0;
+        Entity   entity;
+        void    *payload = nullptr;
+
+        void (*execute)(EntityCommandBuffer &buffer, Command &command) = nullptr;
+        // 排序之后连续的batch相同的命令一起执行, 设置了batch的命令不使用execute
+        void (*batch)(EntityCommandBuffer &buffer, Command *const *commands, size_t count) = nullptr;
+        // 释放payload中保存的回调
+        void (*release)(Command &command) = nullptr;
+    };
+
+    /**
+     * @brief 每个线程私有的命令列表和回调内存
+     */
+    struct ThreadBuffer
+    {
+        vector<Command> commands;
+        // 按块分配的回调内存, 块不会被移动
+        vector<std::unique_ptr<std::byte[]>> blocks;
+        size_t                               blockOffset = 0;
+        // 超过一块大小的回调
+        vector<std::unique_ptr<std::byte[]>> largeBlocks;
+    };
+
+    Command &Record(Kind kind, uint64_t type, Entity entity);
+
+    /**
+     * @brief 从内置组件池中一次分配count个组件, 按顺序添加到命令的目标上, 然后调用init(command, component)
+     */
+    template <typename T, typename Func>
+    void AddComponents(Command *const *commands, size_t count, Func &&init)
+    {
+        vector<T *> components(count);
+        T::Get(count, components.data());
+        for (size_t i = 0; i < count; ++i)
+        {
+            Resolve(commands[i]->entity)->AddComponent(components[i]);
+            init(*commands[i], *components[i]);
+        }
+    }
+
+    void *Allocate(size_t size, size_t align);
+
+    ThreadBuffer &GetThreadBuffer();
+
+    GameObject *Resolve(const Entity &entity);
+
+    void Clear();
+
+    /**
+     * @brief 对所有的线程缓冲区调用func, 只能在同步点上调用
+     */
+    template <typename Func>
+    void ForEachThreadBuffer(Func &&func) const
+    {
+        for (auto &slot : mThreadBuffers)
+        {
+            auto threadBuffer = slot.load(std::memory_order_acquire);
+            if (threadBuffer != nullptr)
+            {
+                func(*threadBuffer);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mOverflowMutex);
+        for (auto &overflow : mOverflowBuffers)
+        {
+            func(*overflow.buffer);
+        }
+    }
+
+    std::array<std::atomic<ThreadBuffer *>, ObjectPoolMaxThreads> mThreadBuffers{};
+
+    /**
+     * @brief 没有拿到线程编号的线程使用的缓冲区, owner是线程的存活标记, 线程退出之后缓冲区被之后的线程复用
+     */
+    struct OverflowBuffer
+    {
+        std::weak_ptr<const bool>     owner;
+        std::unique_ptr<ThreadBuffer> buffer;
+    };
+
+    // 只在查找时加锁, 数量不超过同时存在的超出编号的线程数
+    mutable std::mutex     mOverflowMutex;
+    vector<OverflowBuffer> mOverflowBuffers;
+
+    std::atomic<uint32_t> mDeferredCount{0};
+    // 回放时延迟创建的GameObject, 在同一次回放中被销毁的置空
+    vector<GameObject *> mCreated;
+};
+} // namespace solis
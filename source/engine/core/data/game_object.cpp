@@ -1 +1,50 @@
-#include "core/data/game_object.hpp"
\ No newline at end of file
+#include "core/data/game_object.hpp"
+
+#include <algorithm>
+
+namespace solis {
+void GameObject::SetComponent(uint32_t index, ComponentBase *component)
+{
+    assert(index < MaxComponentTypes);
+
+    auto rank = Rank(index);
+    if (HasComponent(index))
+    {
+        Slots()[rank] = component;
+        return;
+    }
+
+    // 内部的数组满了, 换成两倍大小的堆数组
+    if (mCount == mCapacity)
+    {
+        auto capacity = mCapacity * 2;
+        auto overflow = std::make_unique<ComponentBase *[]>(capacity);
+        std::copy(Slots(), Slots() + mCount, overflow.get());
+
+        mOverflow = std::move(overflow);
+        mCapacity = capacity;
+    }
+
+    auto slots = Slots();
+    std::copy_backward(slots + rank, slots + mCount, slots + mCount + 1);
+    slots[rank] = component;
+
+    mMask[index >> 6] |= uint64_t(1) << (index & 63);
+    mCount++;
+}
+
+void GameObject::EraseComponent(uint32_t index)
+{
+    if (!HasComponent(index))
+    {
+        return;
+    }
+
+    auto rank  = Rank(index);
+    auto slots = Slots();
+    std::copy(slots + rank + 1, slots + mCount, slots + rank);
+
+    mMask[index >> 6] &= ~(uint64_t(1) << (index & 63));
+    mCount--;
+}
+} // namespace solis
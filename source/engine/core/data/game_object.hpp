@@ -1,10 +1,14 @@
 #pragma once
 
+#include <array>
+#include <bit>
+#include <memory>
 #include <type_traits>
 
 #include "core/solis_core.hpp"
 #include "core/base/object.hpp"
 #include "core/base/using.hpp"
+#include "core/base/const.hpp"
 
 #include "core/data/component.hpp"
 
@@ -37,7 +41,7 @@ public:
         {
             Log::SWarning("GameObject add component already exists: {}", ctti::type_id<T>().name().str());
         }
-        mCommponents[ctti::type_id<T>().hash()] = component;
+        SetComponent(T::TypeIndex(), component);
     }
 
     /**
@@ -56,8 +60,8 @@ public:
         {
             Log::SWarning("GameObject add component already exists: {}", ctti::type_id<T>().name().str());
         }
-        auto component                          = T::Get();
-        mCommponents[ctti::type_id<T>().hash()] = component;
+        auto component = T::Get();
+        SetComponent(T::TypeIndex(), component);
         return component;
     }
 
@@ -66,18 +70,83 @@ public:
     std::enable_if_t<std::is_base_of_v<Component<T>, T>, void>
     RemoveComponent()
     {
-        mCommponents.erase(ctti::type_id<T>().hash());
+        EraseComponent(T::TypeIndex());
     }
 
     // Has Component
     template <typename T>
-    bool HasComponent()
+    bool HasComponent() const
     {
-        return mCommponents.find(ctti::type_id<T>().hash()) != mCommponents.end();
+        return HasComponent(T::TypeIndex());
+    }
+
+    /**
+     * @brief 获取组件, 一次位测试加上一次数组访问
+     *
+     * @tparam T
+     * @return T* 没有则返回nullptr
+     */
+    template <typename T>
+    std::enable_if_t<std::is_base_of_v<Component<T>, T>, T *>
+    GetComponent() const
+    {
+        auto index = T::TypeIndex();
+        if (!HasComponent(index))
+        {
+            return nullptr;
+        }
+        return static_cast<T *>(Slots()[Rank(index)]);
+    }
+
+    /**
+     * @brief 组件数量
+     */
+    uint32_t ComponentCount() const
+    {
+        return mCount;
     }
 
 private:
-    ComponentMap            mCommponents;
-    vector<ComponentBase *> mCommponentsList;
+    bool HasComponent(uint32_t index) const
+    {
+        return (mMask[index >> 6] >> (index & 63)) & 1;
+    }
+
+    /**
+     * @brief 类型下标小于index的组件数量, 也就是组件在数组中的位置
+     */
+    uint32_t Rank(uint32_t index) const
+    {
+        uint32_t rank = 0;
+        for (uint32_t w = 0; w < (index >> 6); ++w)
+        {
+            rank += static_cast<uint32_t>(std::popcount(mMask[w]));
+        }
+        auto bits = mMask[index >> 6] & ((uint64_t(1) << (index & 63)) - 1);
+        return rank + static_cast<uint32_t>(std::popcount(bits));
+    }
+
+    ComponentBase *const *Slots() const
+    {
+        return mOverflow != nullptr ? mOverflow.get() : mInline;
+    }
+
+    ComponentBase **Slots()
+    {
+        return mOverflow != nullptr ? mOverflow.get() : mInline;
+    }
+
+    // 添加或者替换组件
+    void SetComponent(uint32_t index, ComponentBase *component);
+
+    void EraseComponent(uint32_t index);
+
+    // 每种组件类型一位
+    std::array<uint64_t, MaxComponentTypes / 64> mMask{};
+    // 按组件类型下标排序的组件, 数量不多时存储在对象内部
+    ComponentBase                     *mInline[GameObjectInlineComponents]{};
+    std::unique_ptr<ComponentBase *[]> mOverflow;
+    uint32_t                           mCount    = 0;
+    uint32_t                           mCapacity = GameObjectInlineComponents;
 };
 } // namespace solis
\ No newline at end of file
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <unordered_map>
 
 #include "core/solis_core.hpp"
 #include "core/base/object.hpp"
 #include "core/base/using.hpp"
 
+#include "core/math/bounds.hpp"
+#include "core/math/triangle_bvh.hpp"
 #include "core/graphics/buffer/buffer.hpp"
 
 namespace solis {
@@ -16,6 +19,15 @@ struct Vertex
     math::vec2 texcoord;
 };
 
+/**
+ * @brief 一级LOD在索引缓冲中的范围, 所有的LOD共用同一个顶点缓冲
+ */
+struct MeshLod
+{
+    uint32_t indexOffset  = 0;
+    uint32_t indicesCount = 0;
+};
+
 struct VertexAttribute
 {
     VkFormat format = VK_FORMAT_UNDEFINED;
@@ -46,6 +58,55 @@ public:
         return mIndexOffset;
     }
 
+    /**
+     * @brief LOD的数量, 至少有1级(原始的网格)
+     */
+    uint32_t GetLodCount() const
+    {
+        return mLods.empty() ? 1 : static_cast<uint32_t>(mLods.size());
+    }
+
+    /**
+     * @brief 第level级LOD的索引范围, 超过最大级数时返回最粗糙的一级
+     */
+    MeshLod GetLod(uint32_t level) const
+    {
+        if (mLods.empty())
+        {
+            return {mIndexOffset, mIndicesCount};
+        }
+        return mLods[std::min<size_t>(level, mLods.size() - 1)];
+    }
+
+    /**
+     * @brief 局部空间的包围盒, 加载时由顶点位置计算
+     */
+    const AABB &GetBounds() const
+    {
+        return mBounds;
+    }
+
+    /**
+     * @brief 保留在CPU端的顶点位置和三角形索引, 用于遮挡剔除和射线检测
+     */
+    const vector<math::vec3> &GetPositions() const
+    {
+        return mPositions;
+    }
+
+    const vector<uint32_t> &GetIndices() const
+    {
+        return mIndices;
+    }
+
+    /**
+     * @brief LOD0的三角形BVH, 加载时构建, 用于射线和线段检测
+     */
+    const TriangleBVH &GetTriangleBVH() const
+    {
+        return mTriangleBVH;
+    }
+
     void SetAttribute(const string &name, const VertexAttribute &attribute)
     {
         mAttributes.insert({name, attribute});
@@ -82,6 +143,15 @@ private:
     uint32_t mIndicesCount  = 0;
     uint32_t mVerticesCount = 0;
 
+    AABB mBounds;
+
+    vector<math::vec3> mPositions;
+    vector<uint32_t>   mIndices;
+
+    vector<MeshLod> mLods;
+
+    TriangleBVH mTriangleBVH;
+
     std::unique_ptr<graphics::Buffer> mIndexBuffer;
 
     std::unordered_map<string, graphics::Buffer> mBuffers;
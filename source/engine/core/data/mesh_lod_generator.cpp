@@ -0,0 +1,79 @@
+#include "core/data/mesh_lod_generator.hpp"
+
+#include <unordered_map>
+
+namespace solis {
+vector<vector<uint32_t>> MeshLodGenerator::Generate(std::span<const math::vec3> positions, std::span<const uint32_t> indices, const AABB &bounds)
+{
+    vector<vector<uint32_t>> lods;
+
+    auto previous = indices.size();
+    for (uint32_t level = 1; level < MeshMaxLods; ++level)
+    {
+        auto grid       = std::max(MeshLodBaseGrid >> (level - 1), 1u);
+        auto simplified = Simplify(positions, indices, bounds, grid);
+        if (simplified.empty() || static_cast<float>(simplified.size()) > static_cast<float>(previous) * MeshLodMinReduction)
+        {
+            break;
+        }
+
+        previous = simplified.size();
+        lods.push_back(std::move(simplified));
+    }
+    return lods;
+}
+
+vector<uint32_t> MeshLodGenerator::Simplify(std::span<const math::vec3> positions, std::span<const uint32_t> indices, const AABB &bounds, uint32_t grid)
+{
+    vector<uint32_t> result;
+    if (!bounds.IsValid() || grid == 0)
+    {
+        return result;
+    }
+
+    // 立方体的格子, 边长由最长的轴决定
+    auto size     = bounds.max - bounds.min;
+    auto cellSize = std::max(std::max(size.x, size.y), size.z) / static_cast<float>(grid);
+    if (cellSize <= 0.0f)
+    {
+        return result;
+    }
+    auto invCellSize = 1.0f / cellSize;
+
+    auto cellKey = [&](const math::vec3 &position) {
+        auto cell = math::clamp(math::uvec3((position - bounds.min) * invCellSize), math::uvec3(0), math::uvec3(grid - 1));
+        return (static_cast<uint64_t>(cell.x) << 42) | (static_cast<uint64_t>(cell.y) << 21) | static_cast<uint64_t>(cell.z);
+    };
+
+    // 顶点 -> 格子的代表顶点
+    static const uint32_t Unmapped = 0xFFFFFFFF;
+    vector<uint32_t>                       remap(positions.size(), Unmapped);
+    std::unordered_map<uint64_t, uint32_t> cells;
+    cells.reserve(std::min<size_t>(positions.size(), static_cast<size_t>(grid) * grid * grid));
+
+    auto representative = [&](uint32_t vertex) {
+        auto &mapped = remap[vertex];
+        if (mapped == Unmapped)
+        {
+            mapped = cells.try_emplace(cellKey(positions[vertex]), vertex).first->second;
+        }
+        return mapped;
+    };
+
+    result.reserve(indices.size() / 2);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        auto a = representative(indices[i]);
+        auto b = representative(indices[i + 1]);
+        auto c = representative(indices[i + 2]);
+        if (a == b || b == c || a == c)
+        {
+            continue;
+        }
+        result.push_back(a);
+        result.push_back(b);
+        result.push_back(c);
+    }
+    return result;
+}
+} // namespace solis
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <span>
+
+#include "core/solis_core.hpp"
+#include "core/base/using.hpp"
+#include "core/base/const.hpp"
+
+#include "core/math/bounds.hpp"
+
+namespace solis {
+/**
+ * @brief 用顶点聚类生成更粗糙的LOD, 只生成新的索引, 所有的LOD共用原来的顶点缓冲
+ */
+class SOLIS_CORE_API MeshLodGenerator
+{
+public:
+    /**
+     * @brief 生成LOD1到LOD(MeshMaxLods - 1)的索引, 简化的效果不明显时提前停止
+     *
+     * @param positions 顶点位置
+     * @param indices LOD0的三角形索引
+     * @param bounds 顶点的包围盒
+     * @return vector<vector<uint32_t>> 每一级的索引, 不包括LOD0
+     */
+    static vector<vector<uint32_t>> Generate(std::span<const math::vec3> positions, std::span<const uint32_t> indices, const AABB &bounds);
+
+    /**
+     * @brief 把包围盒分成grid^3个格子, 同一个格子里的顶点合并成格子中第一个被引用的顶点, 退化的三角形被删除
+     *
+     * @param grid 最长的轴上的格子数量
+     */
+    static vector<uint32_t> Simplify(std::span<const math::vec3> positions, std::span<const uint32_t> indices, const AABB &bounds, uint32_t grid);
+};
+} // namespace solis
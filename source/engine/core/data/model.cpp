@@ -2,6 +2,7 @@
 #include "core/log/log.hpp"
 
 #include "core/math/math.hpp"
+#include "core/data/mesh_lod_generator.hpp"
 
 #ifndef TINYGLTF_IMPLEMENTATION
 #define TINYGLTF_IMPLEMENTATION
@@ -123,6 +124,10 @@ void Model::LoadMeshes(tinygltf::Model &model)
             auto normal_data   = reinterpret_cast<float *>(&normal_buffer.data[normal_buffer_view.byteOffset + normal_accessor.byteOffset]);
             auto texcoord_data = reinterpret_cast<float *>(&texcoord_buffer.data[texcoord_buffer_view.byteOffset + texcoord_accessor.byteOffset]);
 
+            // 每个primitive的索引都从0开始, 合并到同一个顶点缓冲中时需要加上前面的顶点数量
+            auto baseVertex = static_cast<uint32_t>(vertices_mesh.size());
+            auto baseIndex  = indices_mesh.size();
+
             for (size_t v = 0; v < position_accessor.count; v++)
             {
                 Vertex vertex{};
@@ -130,6 +135,8 @@ void Model::LoadMeshes(tinygltf::Model &model)
                 vertex.normal   = math::normalize(math::make_vec3(&normal_data[v * 3]));
                 vertex.texcoord = math::make_vec2(&texcoord_data[v * 2]);
                 vertices_mesh.push_back(vertex);
+
+                m->mBounds.Merge(math::vec3(vertex.position));
             }
 
             uint32_t sizeIndex = 0;
@@ -161,11 +168,32 @@ void Model::LoadMeshes(tinygltf::Model &model)
             {
                 indices_mesh.insert(indices_mesh.end(), (uint32_t *)indexData, (uint32_t *)indexData + index_accessor.count);
             }
+
+            for (auto i = baseIndex; i < indices_mesh.size(); ++i)
+            {
+                indices_mesh[i] += baseVertex;
+            }
         }
 
         m->mVerticesCount = vertices_mesh.size();
         m->mIndicesCount  = indices_mesh.size();
 
+        m->mPositions.reserve(vertices_mesh.size());
+        for (auto &vertex : vertices_mesh)
+        {
+            m->mPositions.emplace_back(vertex.position);
+        }
+        m->mIndices = indices_mesh;
+        m->mTriangleBVH.Build(m->mPositions, m->mIndices);
+
+        // 更粗糙的LOD的索引追加在LOD0后面, 放在同一个索引缓冲中
+        m->mLods.push_back({0, static_cast<uint32_t>(indices_mesh.size())});
+        for (auto &lod : MeshLodGenerator::Generate(m->mPositions, m->mIndices, m->mBounds))
+        {
+            m->mLods.push_back({static_cast<uint32_t>(indices_mesh.size()), static_cast<uint32_t>(lod.size())});
+            indices_mesh.insert(indices_mesh.end(), lod.begin(), lod.end());
+        }
+
         using BufferType = graphics::Buffer::Type;
         graphics::Buffer vertexBuffer{BufferType::Vertex, vertices_mesh.size() * sizeof(Vertex), vertices_mesh.data()};
         m->mBuffers.insert({"vertex", std::move(vertexBuffer)});
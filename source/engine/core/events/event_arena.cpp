@@ -0,0 +1,84 @@
+#include "core/events/event_arena.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "core/events/event_manager.hpp"
+
+namespace solis {
+EventArena::~EventArena()
+{
+    for (auto &buffer : mBuffers)
+    {
+        Destroy(buffer);
+        for (auto &block : buffer.blocks)
+        {
+            ObjectBase::Free(block.data);
+        }
+    }
+}
+
+std::span<const EventArena::Record> EventArena::Swap()
+{
+    assert(mBuffers[mWrite ^ 1].records.empty() && "EventArena::Swap: the read buffer must be released first");
+
+    auto &read = mBuffers[mWrite];
+    mWrite ^= 1;
+    return read.records;
+}
+
+void EventArena::Release()
+{
+    Destroy(mBuffers[mWrite ^ 1]);
+}
+
+size_t EventArena::GetCapacity() const
+{
+    size_t capacity = 0;
+    for (auto &buffer : mBuffers)
+    {
+        for (auto &block : buffer.blocks)
+        {
+            capacity += block.size;
+        }
+    }
+    return capacity;
+}
+
+void *EventArena::Allocate(Buffer &buffer, size_t size)
+{
+    static const size_t Alignment = alignof(std::max_align_t);
+
+    size = (size + Alignment - 1) & ~(Alignment - 1);
+    while (buffer.block < buffer.blocks.size())
+    {
+        auto &block = buffer.blocks[buffer.block];
+        if (buffer.offset + size <= block.size)
+        {
+            auto ptr = block.data + buffer.offset;
+            buffer.offset += size;
+            return ptr;
+        }
+
+        // 剩下的块中可能有之前为大事件分配的块, 继续向后找
+        buffer.block++;
+        buffer.offset = 0;
+    }
+
+    auto blockSize = std::max(size, EventArenaBlockSize);
+    buffer.blocks.push_back({static_cast<std::byte *>(ObjectBase::Malloc(blockSize, "EventArena")), blockSize});
+    buffer.offset = size;
+    return buffer.blocks.back().data;
+}
+
+void EventArena::Destroy(Buffer &buffer)
+{
+    for (auto &record : buffer.records)
+    {
+        record.event->~Event();
+    }
+    buffer.records.clear();
+    buffer.block  = 0;
+    buffer.offset = 0;
+}
+} // namespace solis
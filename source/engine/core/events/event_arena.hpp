@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <span>
+#include <utility>
+
+#include "core/solis_core.hpp"
+
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+#include "core/base/const.hpp"
+#include "core/base/i_noncopyable.hpp"
+
+#include "core/events/event_type.hpp"
+
+namespace solis {
+class Event;
+
+/**
+ * @brief 投递事件用的双缓冲帧内存, 事件在写缓冲中顺序分配, 同时按分配顺序记录事件的类型编号
+ * Swap之后写缓冲变成读缓冲, 分发期间投递的新事件进入另一个缓冲, 不会影响正在遍历的记录
+ * Release一次性析构读缓冲中的所有事件并回退内存, 内存块会被保留下来, 稳定之后不再分配内存
+ *
+ * 不是线程安全的
+ */
+class SOLIS_CORE_API EventArena : public Object<EventArena>, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(EventArena)
+
+    struct Record
+    {
+        // EventTypeRegistry中的编号
+        uint32_t type;
+        Event   *event;
+    };
+
+    EventArena() = default;
+    virtual ~EventArena();
+
+    /**
+     * @brief 在写缓冲中构造一个事件, 在它所在的缓冲被Release之前有效
+     */
+    template <typename T, typename... P>
+    T *New(P &&...p)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "EventArena: over-aligned events are not supported");
+
+        auto &buffer = mBuffers[mWrite];
+        auto  event  = ::new (Allocate(buffer, sizeof(T))) T(std::forward<P>(p)...);
+        buffer.records.push_back({EventTypeRegistry::Index<T>(), event});
+        return event;
+    }
+
+    /**
+     * @brief 交换读写缓冲, 上一次的读缓冲必须已经被Release
+     *
+     * @return std::span<const Record> 交换出来的事件, 按分配的顺序, 在Release之前有效
+     */
+    std::span<const Record> Swap();
+
+    /**
+     * @brief 析构读缓冲中的所有事件, 回退读缓冲的内存
+     */
+    void Release();
+
+    /**
+     * @brief 写缓冲中的事件数量
+     */
+    size_t Count() const
+    {
+        return mBuffers[mWrite].records.size();
+    }
+
+    /**
+     * @brief 两个缓冲一共保留的内存(字节)
+     */
+    size_t GetCapacity() const;
+
+private:
+    struct Block
+    {
+        std::byte *data = nullptr;
+        size_t     size = 0;
+    };
+
+    struct Buffer
+    {
+        vector<Block>  blocks;
+        // 正在使用的块和块内的偏移
+        size_t         block  = 0;
+        size_t         offset = 0;
+        vector<Record> records;
+    };
+
+    /**
+     * @brief 在buffer中按max_align_t对齐分配size字节, 当前块不够时使用下一块, 没有足够大的块时分配新的块
+     */
+    void *Allocate(Buffer &buffer, size_t size);
+
+    void Destroy(Buffer &buffer);
+
+    Buffer   mBuffers[2];
+    uint32_t mWrite = 0;
+};
+} // namespace solis
@@ -7,155 +7,235 @@ namespace solis {
 EventManager::~EventManager()
 {
     Dispatch();
-    for (auto &[eventType, eventData] : mLatchedEvents)
+
+    // Before the event manager dies, make sure no stale EventHandler objects try to unregister themselves.
+    auto release = [](auto &handlers) {
+        for (auto &handler : handlers)
+        {
+            if (handler.mHandler == nullptr)
+                continue;
+            handler.mUnregisterKey->mRegistrations = EventHandler::InvalidRegistration;
+            handler.mUnregisterKey->ReleaseManagerReference();
+        }
+    };
+
+    for (auto &eventData : mLatchedEvents)
     {
-        for (auto &[pri, handlers] : eventData.mHandlers)
+        if (!eventData)
+            continue;
+
+        for (auto &handler : eventData->mHandlers)
         {
-            for (auto &handler : handlers)
-            {
-                DispatchDownEvents(eventData.mQueuedEvents, handler);
-                // Before the event manager dies, make sure no stale EventHandler objects try to unregister themselves.
-                handler.mUnregisterKey->ReleaseManagerReference();
-            }
+            if (handler.mHandler != nullptr)
+                DispatchDownEvents(eventData->mQueuedEvents, handler);
         }
+        release(eventData->mHandlers);
+        release(eventData->mRecursiveHandlers);
+    }
+
+    for (auto &eventData : mEvents)
+    {
+        if (!eventData)
+            continue;
+
+        release(eventData->mHandlers);
+        release(eventData->mRecursiveHandlers);
     }
 }
 
 void EventManager::Dispatch()
 {
-    for (auto &[eventType, eventData] : mEvents)
+    for (auto &[type, event] : mQueuedEvents.Swap())
     {
-        auto &queued_events = eventData.mQueuedEvents;
-        for (auto &[pri, handlers] : eventData.mHandlers)
-        {
-            auto itr = std::remove_if(begin(handlers), end(handlers), [&](const Handler &handler) {
-                for (auto &event : queued_events)
-                {
-                    if (!handler.mem_fn(handler.mHandler, *event))
-                    {
-                        handler.mUnregisterKey->ReleaseManagerReference();
-                        return true;
-                    }
-                }
-                return false;
-            });
-            handlers.erase(itr, end(handlers));
-        }
-        queued_events.clear();
+        DispatchInline(type, *event);
     }
+    mQueuedEvents.Release();
+
+    DispatchConcurrent();
 }
 
-void EventManager::DispatchEvent(vector<Handler> &handlers, const Event &e)
+void EventManager::DispatchConcurrent()
 {
-    auto itr = std::remove_if(begin(handlers), end(handlers), [&](const Handler &handler) -> bool {
-        bool to_remove = !handler.mem_fn(handler.mHandler, e);
-        if (to_remove)
-            handler.mUnregisterKey->ReleaseManagerReference();
-        return to_remove;
+    assert(IsMainThread() && "EventManager::DispatchConcurrent: must be called on the main thread");
+
+    // 只交换一次链表头, 工作线程持续入队时也不会一直分发下去
+    mConcurrentEvents.reverseSweep([&](ConcurrentEvent &&event) {
+        mConcurrentBatch.push_back(std::move(event));
     });
 
-    handlers.erase(itr, end(handlers));
+    for (auto it = mConcurrentBatch.rbegin(); it != mConcurrentBatch.rend(); ++it)
+    {
+        DispatchInline(it->type, *it->event);
+    }
+    mConcurrentBatch.clear();
 }
 
-void EventManager::DispatchUpEvents(vector<Event *> &up_events, const LatchHandler &handler)
+EventManager::EventTypeData &EventManager::GetEventData(uint32_t type)
 {
-    for (auto &event : up_events)
-        handler.up_fn(handler.mHandler, *event);
+    if (type >= mEvents.size())
+        mEvents.resize(std::max<size_t>(type + 1, EventTypeRegistry::Count()));
+    if (!mEvents[type])
+        mEvents[type] = std::make_unique<EventTypeData>();
+    return *mEvents[type];
 }
 
-void EventManager::DispatchDownEvents(vector<Event *> &down_events, const LatchHandler &handler)
+EventManager::LatchEventTypeData &EventManager::GetLatchedData(uint32_t type)
 {
-    for (auto &event : down_events)
-        handler.down_fn(handler.mHandler, *event);
+    if (type >= mLatchedEvents.size())
+        mLatchedEvents.resize(std::max<size_t>(type + 1, EventTypeRegistry::Count()));
+    if (!mLatchedEvents[type])
+        mLatchedEvents[type] = std::make_unique<LatchEventTypeData>();
+    return *mLatchedEvents[type];
 }
 
-void EventManager::LatchEventTypeData::FlushRecursiveHandlers()
+uint32_t EventManager::NewRegistration(EventHandler *handler, uint32_t type, bool latched)
 {
-    mHandlers[0].insert(end(mHandlers[0]), begin(mRecursiveHandlers), end(mRecursiveHandlers));
-    mRecursiveHandlers.clear();
+    uint32_t id;
+    if (mFreeRegistrations.empty())
+    {
+        id = static_cast<uint32_t>(mRegistrations.size());
+        mRegistrations.emplace_back();
+    }
+    else
+    {
+        id = mFreeRegistrations.back();
+        mFreeRegistrations.pop_back();
+    }
+
+    auto &registration      = mRegistrations[id];
+    registration            = Registration();
+    registration.type       = type;
+    registration.latched    = latched;
+    registration.next       = handler->mRegistrations;
+    handler->mRegistrations = id;
+    return id;
 }
 
-void EventManager::EventTypeData::FlushRecursiveHandlers()
+void EventManager::ReleaseRegistration(uint32_t id)
 {
-    mHandlers[0].insert(end(mHandlers[0]), begin(mRecursiveHandlers), end(mRecursiveHandlers));
-    mRecursiveHandlers.clear();
+    auto release = [&](auto &l) {
+        auto registration = mRegistrations[id];
+        auto &handler     = registration.pending ? l.mRecursiveHandlers[registration.index] : l.mHandlers[registration.index];
+        auto  key         = handler.mUnregisterKey;
+        handler.mHandler  = nullptr;
+
+        // 分发中的数组不能移动, 其它时候注销的数量超过一半时压缩, 均摊下来每次注销是O(1)
+        if (!registration.pending && ++l.mTombstones * 2 > l.mHandlers.size() && !l.mDispatching)
+            CompactHandlers(l);
+
+        mFreeRegistrations.push_back(id);
+        key->ReleaseManagerReference();
+    };
+
+    if (mRegistrations[id].latched)
+        release(*mLatchedEvents[mRegistrations[id].type]);
+    else
+        release(*mEvents[mRegistrations[id].type]);
+}
+
+void EventManager::DispatchEvent(EventTypeData &l, const Event &e)
+{
+    // 分发期间注册的处理函数进入mRecursiveHandlers, 注销只做标记, 数组不会移动
+    auto count = l.mHandlers.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto handler = l.mHandlers[i];
+        if (handler.mHandler == nullptr || handler.mem_fn(handler.mHandler, e))
+            continue;
+
+        // 返回false表示不再处理这个事件, 处理函数中可能已经注销了自己
+        if (l.mHandlers[i].mHandler == nullptr)
+            continue;
+
+        auto  key  = handler.mUnregisterKey;
+        auto *link = &key->mRegistrations;
+        while (*link != handler.mRegistration)
+            link = &mRegistrations[*link].next;
+        *link = mRegistrations[handler.mRegistration].next;
+        ReleaseRegistration(handler.mRegistration);
+    }
+}
+
+void EventManager::DispatchUpEvents(vector<std::unique_ptr<Event>> &up_events, const LatchHandler &handler)
+{
+    for (auto &event : up_events)
+        handler.up_fn(handler.mHandler, *event);
+}
+
+void EventManager::DispatchDownEvents(vector<std::unique_ptr<Event>> &down_events, const LatchHandler &handler)
+{
+    for (auto &event : down_events)
+        handler.down_fn(handler.mHandler, *event);
 }
 
 void EventManager::DispatchUpEvent(LatchEventTypeData &event_type, const Event &event)
 {
     event_type.mDispatching = true;
-    for (auto &[pri, handlers] : event_type.mHandlers)
+    for (size_t i = 0, count = event_type.mHandlers.size(); i < count; ++i)
     {
-        for (auto &handler : handlers)
+        auto handler = event_type.mHandlers[i];
+        if (handler.mHandler != nullptr)
             handler.up_fn(handler.mHandler, event);
     }
-    event_type.FlushRecursiveHandlers();
+    FlushHandlers(event_type);
     event_type.mDispatching = false;
 }
 
 void EventManager::DispatchDownEvent(LatchEventTypeData &event_type, const Event &event)
 {
     event_type.mDispatching = true;
-    for (auto &[pri, handlers] : event_type.mHandlers)
+    for (size_t i = 0, count = event_type.mHandlers.size(); i < count; ++i)
     {
-        for (auto &handler : handlers)
+        auto handler = event_type.mHandlers[i];
+        if (handler.mHandler != nullptr)
             handler.down_fn(handler.mHandler, event);
     }
-    event_type.FlushRecursiveHandlers();
+    FlushHandlers(event_type);
     event_type.mDispatching = false;
 }
 
 void EventManager::UnregisterHandler(EventHandler *handler)
 {
-    for (auto &[eventType, eventData] : mEvents)
-    {
-        for (auto &[pri, handlers] : eventData.mHandlers)
-        {
-            auto itr = std::remove_if(begin(handlers), end(handlers), [&](const Handler &h) -> bool {
-                bool to_remove = h.mUnregisterKey == handler;
-                if (to_remove)
-                    h.mUnregisterKey->ReleaseManagerReference();
-                return to_remove;
-            });
-
-            if (itr != end(handlers) && eventData.mDispatching)
-                throw std::logic_error("Unregistering handlers while dispatching events.");
-
-            if (itr != end(handlers))
-                handlers.erase(itr, end(handlers));
-        }
-    }
+    UnregisterHandler(handler, false);
 }
 
 void EventManager::UnregisterLatchHandler(EventHandler *handler)
 {
-    for (auto &[event_type, eventData] : mLatchedEvents)
+    UnregisterHandler(handler, true);
+}
+
+void EventManager::UnregisterHandler(EventHandler *handler, bool latched)
+{
+    // 先从链表中摘下来再释放, 释放最后一个引用时handler会断开和EventManager的关联
+    auto *link = &handler->mRegistrations;
+    while (*link != EventHandler::InvalidRegistration)
     {
-        for (auto &[pri, handlers] : eventData.mHandlers)
+        auto id = *link;
+        if (mRegistrations[id].latched != latched)
         {
-            auto itr = std::remove_if(begin(handlers), end(handlers), [&](const LatchHandler &h) -> bool {
-                bool to_remove = h.mUnregisterKey == handler;
-                if (to_remove)
-                    h.mUnregisterKey->ReleaseManagerReference();
-                return to_remove;
-            });
-
-            if (itr != end(handlers))
-                handlers.erase(itr, end(handlers));
+            link = &mRegistrations[id].next;
+            continue;
         }
+
+        *link = mRegistrations[id].next;
+        ReleaseRegistration(id);
     }
 }
 
 void EventManager::DequeueLatched(uint64_t cookie)
 {
-    for (auto &[eventType, eventData] : mLatchedEvents)
+    for (auto &latched : mLatchedEvents)
     {
+        if (!latched)
+            continue;
+
+        auto &eventData     = *latched;
         auto &queued_events = eventData.mQueuedEvents;
         if (eventData.mEnqueueing)
             throw std::logic_error("Dequeueing latched while queueing events.");
         eventData.mEnqueueing = true;
 
-        auto itr = std::remove_if(begin(queued_events), end(queued_events), [&](const Event *event) {
+        auto itr = std::remove_if(begin(queued_events), end(queued_events), [&](const std::unique_ptr<Event> &event) {
             bool signal = event->GetCookie() == cookie;
             if (signal)
                 DispatchDownEvent(eventData, *event);
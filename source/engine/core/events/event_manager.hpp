@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <stdexcept>
+#include <thread>
 #include <utility>
 
 #include "core/solis_core.hpp"
@@ -10,6 +12,9 @@
 #include "core/base/using.hpp"
 #include "core/base/module.hpp"
 
+#include "core/events/event_arena.hpp"
+#include "core/events/event_type.hpp"
+
 #include "ctti/type_id.hpp"
 
 namespace solis {
@@ -69,8 +74,14 @@ public:
     void ReleaseManagerReference();
 
 private:
+    friend class EventManager;
+
+    inline static const uint32_t InvalidRegistration = 0xFFFFFFFF;
+
     EventManager *mEventManager         = nullptr;
     uint32_t      mEventManagerRefCount = 0;
+    // EventManager中这个对象的第一个注册, 所有的注册串成一个链表, 注销时只需要遍历自己的注册
+    uint32_t mRegistrations = InvalidRegistration;
 };
 
 class SOLIS_CORE_API EventManager : public Object<EventManager>
@@ -79,23 +90,47 @@ public:
     EventManager() = default;
     ~EventManager();
 
+    /**
+     * @brief 事件在帧内存中构造, 下一次Dispatch时按入队的顺序分发, 然后一起释放
+     * 可以在任何线程中调用, 不在主线程时转给EnqueueConcurrent
+     */
     template <typename T, typename... P>
     void Enqueue(P &&...p)
     {
-        static constexpr auto type = ctti::type_id<T>().hash();
-        auto                 &l    = mEvents[type];
+        if (!IsMainThread())
+        {
+            EnqueueConcurrent<T>(std::forward<P>(p)...);
+            return;
+        }
+        mQueuedEvents.New<T>(std::forward<P>(p)...);
+    }
 
-        auto ptr = std::unique_ptr<Event>(new T(std::forward<P>(p)...));
-        l.mQueuedEvents.emplace_back(std::move(ptr));
+    /**
+     * @brief 无锁的多生产者入队, 用于资源加载, 物理和网络等工作线程
+     * 主线程在DispatchConcurrent中一次性分发, 同一个线程入队的事件保持顺序
+     */
+    template <typename T, typename... P>
+    void EnqueueConcurrent(P &&...p)
+    {
+        // 不经过Object的内存统计, 它不是线程安全的
+        ConcurrentEventPtr event(::new T(std::forward<P>(p)...), [](Event *event) { ::delete static_cast<T *>(event); });
+        mConcurrentEvents.insertHead({EventTypeRegistry::Index<T>(), std::move(event)});
+    }
+
+    /**
+     * @brief 是否是创建EventManager的线程, 只有这个线程可以分发事件
+     */
+    bool IsMainThread() const
+    {
+        return std::this_thread::get_id() == mMainThread;
     }
 
     template <typename T, typename... P>
     uint64_t EnqueueLatched(P &&...p)
     {
-        static constexpr auto type   = ctti::type_id<T>().hash();
-        auto                 &l      = mLatchedEvents[type];
-        auto                  ptr    = std::unique_ptr<Event>(new T(std::forward<P>(p)...));
-        uint64_t              cookie = ++mCookieCounter;
+        auto    &l      = GetLatchedData(EventTypeRegistry::Index<T>());
+        auto     ptr    = std::unique_ptr<Event>(new T(std::forward<P>(p)...));
+        uint64_t cookie = ++mCookieCounter;
         ptr->SetCookie(cookie);
 
         if (l.mEnqueueing)
@@ -114,8 +149,7 @@ public:
     template <typename EventType>
     void DequeueAllLatched()
     {
-        static constexpr auto type       = ctti::type_id<EventType>().hash();
-        auto                 &event_type = mLatchedEvents[type];
+        auto &event_type = GetLatchedData(EventTypeRegistry::Index<EventType>());
         if (event_type.mEnqueueing)
             throw std::logic_error("Dequeueing latched while queueing events.");
 
@@ -130,67 +164,98 @@ public:
     std::enable_if_t<std::is_base_of_v<Event, T>, void>
     DispatchInline(const T &t)
     {
-        static constexpr auto type = ctti::type_id<T>().hash();
-        auto                 &l    = mEvents[type];
-        for (auto &[pri, h] : l.mHandlers)
-            DispatchEvent(h, t);
+        DispatchInline(EventTypeRegistry::Index<T>(), t);
     }
 
-    void DispatchInline(uint64_t type_id, const Event &e)
+    /**
+     * @brief 按类型编号分发, 没有处理函数的类型只需要一次比较
+     *
+     * @param type EventTypeRegistry中的编号
+     * @param e
+     */
+    void DispatchInline(uint32_t type, const Event &e)
     {
-        auto &l = mEvents[type_id];
-        for (auto &[pri, h] : l.mHandlers)
-            DispatchEvent(h, e);
+        if (type >= mEvents.size() || !mEvents[type] || mEvents[type]->mHandlers.empty())
+            return;
+
+        // 处理函数中注册的处理函数先放在mRecursiveHandlers中, 注销的处理函数只做标记
+        // 最外层的分发结束之后再压缩和加入
+        auto &l           = *mEvents[type];
+        auto  dispatching = l.mDispatching;
+        l.mDispatching    = true;
+        DispatchEvent(l, e);
+        l.mDispatching = dispatching;
+        if (!dispatching)
+            FlushHandlers(l);
     }
 
     void Dispatch();
 
+    /**
+     * @brief 分发其它线程入队的事件, 只处理调用时已经入队的事件, 分发期间新入队的留到下一次
+     */
+    void DispatchConcurrent();
+
+    /**
+     * @brief 注册处理函数, 按priority从小到大调用, 相同优先级按注册的顺序
+     */
     template <typename T, typename EventType, bool (T::*mem_fn)(const EventType &)>
     void RegisterHandler(T *handler, uint32_t priority = 0)
     {
         handler->AddManagerReference(this);
-        static constexpr auto type_id = ctti::type_id<EventType>().hash();
-        auto                 &l       = mEvents[type_id];
+        auto    type = EventTypeRegistry::Index<EventType>();
+        auto   &l    = GetEventData(type);
+        Handler h{MemberFunction<bool, T, EventType, mem_fn>, handler, handler, priority, NewRegistration(handler, type, false)};
         if (l.mDispatching)
-            l.mRecursiveHandlers.push_back({MemberFunction<bool, T, EventType, mem_fn>, handler, handler});
+            AddRecursiveHandler(l, h);
         else
-        {
-            l.mHandlers[priority].push_back({MemberFunction<bool, T, EventType, mem_fn>, handler, handler});
-        }
+            InsertHandler(l.mHandlers, h);
     }
 
+    /**
+     * @brief 注销handler的所有处理函数, 只访问它自己的注册, 分发中也可以调用
+     */
     void UnregisterHandler(EventHandler *handler);
 
     template <typename T, typename EventType, void (T::*up_fn)(const EventType &), void (T::*down_fn)(const EventType &)>
     void RegisterLatchHandler(T *handler, uint32_t priority = 0)
     {
         handler->AddManagerReference(this);
+        auto         type = EventTypeRegistry::Index<EventType>();
         LatchHandler h{
             MemberFunction<void, T, EventType, up_fn>,
             MemberFunction<void, T, EventType, down_fn>,
-            handler, handler};
+            handler, handler, priority, NewRegistration(handler, type, true)};
 
-        static constexpr auto type_id = EventType::get_type_id();
-        auto                 &levents = mLatchedEvents[type_id];
-        DispatchUpEvents(levents.mQueuedEvents, h);
+        auto &l = GetLatchedData(type);
+        DispatchUpEvents(l.mQueuedEvents, h);
 
-        auto &l = mLatchedEvents[type_id];
         if (l.mDispatching)
-            l.mRecursiveHandlers.push_back(h);
+            AddRecursiveHandler(l, h);
         else
-        {
-            l.mHandlers[priority].push_back(h);
-        }
+            InsertHandler(l.mHandlers, h);
     }
 
     void UnregisterLatchHandler(EventHandler *handler);
 
 private:
+    // 按构造时的类型释放
+    using ConcurrentEventPtr = std::unique_ptr<Event, void (*)(Event *)>;
+
+    struct ConcurrentEvent
+    {
+        uint32_t           type;
+        ConcurrentEventPtr event;
+    };
+
+    // mHandler为空的是已经注销的处理函数, 在压缩时去掉
     struct Handler
     {
         bool (*mem_fn)(void *object, const Event &event);
         void         *mHandler;
         EventHandler *mUnregisterKey;
+        uint32_t      mPriority;
+        uint32_t      mRegistration;
     };
 
     struct LatchHandler
@@ -199,38 +264,157 @@ private:
         void (*down_fn)(void *object, const Event &event);
         void         *mHandler;
         EventHandler *mUnregisterKey;
+        uint32_t      mPriority;
+        uint32_t      mRegistration;
     };
 
     struct EventTypeData
     {
-        vector<Event *>                     mQueuedEvents;
-        sort_map<uint32_t, vector<Handler>> mHandlers;
-        vector<Handler>                     mRecursiveHandlers;
-        bool                                mEnqueueing  = false;
-        bool                                mDispatching = false;
-
-        void FlushRecursiveHandlers();
+        // 按优先级排好序的扁平数组, 分发时直接顺序遍历
+        vector<Handler> mHandlers;
+        vector<Handler> mRecursiveHandlers;
+        // mHandlers中已经注销的数量
+        uint32_t        mTombstones  = 0;
+        bool            mEnqueueing  = false;
+        bool            mDispatching = false;
     };
 
     struct LatchEventTypeData
     {
-        vector<Event *>                          mQueuedEvents;
-        sort_map<uint32_t, vector<LatchHandler>> mHandlers;
-        vector<LatchHandler>                     mRecursiveHandlers;
-        bool                                     mEnqueueing  = false;
-        bool                                     mDispatching = false;
+        vector<std::unique_ptr<Event>> mQueuedEvents;
+        vector<LatchHandler>           mHandlers;
+        vector<LatchHandler>           mRecursiveHandlers;
+        uint32_t                       mTombstones  = 0;
+        bool                           mEnqueueing  = false;
+        bool                           mDispatching = false;
+    };
 
-        void FlushRecursiveHandlers();
+    /**
+     * @brief 一个处理函数在类型数据中的位置, 同一个EventHandler的注册通过next串起来
+     */
+    struct Registration
+    {
+        uint32_t type    = 0;
+        // 在mHandlers中的下标, pending时是在mRecursiveHandlers中的下标
+        uint32_t index   = 0;
+        uint32_t next    = EventHandler::InvalidRegistration;
+        bool     latched = false;
+        bool     pending = false;
     };
 
-    void DispatchEvent(vector<Handler> &handlers, const Event &e);
-    void DispatchUpEvents(vector<Event *> &events, const LatchHandler &handler);
-    void DispatchDownEvents(vector<Event *> &events, const LatchHandler &handler);
+    /**
+     * @brief 分配一个注册并挂到handler的链表头部, 位置在加入数组时设置
+     */
+    uint32_t NewRegistration(EventHandler *handler, uint32_t type, bool latched);
+
+    /**
+     * @brief 插入到相同优先级的最后面, 保持数组有序, 被移动的处理函数更新注册中的下标
+     * 大部分处理函数使用相同的优先级, 直接加在最后面, 不需要移动
+     */
+    template <typename H>
+    void InsertHandler(vector<H> &handlers, const H &handler)
+    {
+        auto it = std::upper_bound(handlers.begin(), handlers.end(), handler.mPriority, [](uint32_t priority, const H &h) {
+            return priority < h.mPriority;
+        });
+        auto index = static_cast<size_t>(it - handlers.begin());
+        handlers.insert(it, handler);
+        for (; index < handlers.size(); ++index)
+        {
+            if (handlers[index].mHandler != nullptr)
+            {
+                auto &registration   = mRegistrations[handlers[index].mRegistration];
+                registration.index   = static_cast<uint32_t>(index);
+                registration.pending = false;
+            }
+        }
+    }
+
+    template <typename Data, typename H>
+    void AddRecursiveHandler(Data &l, const H &handler)
+    {
+        auto &registration   = mRegistrations[handler.mRegistration];
+        registration.index   = static_cast<uint32_t>(l.mRecursiveHandlers.size());
+        registration.pending = true;
+        l.mRecursiveHandlers.push_back(handler);
+    }
+
+    /**
+     * @brief 去掉已经注销的处理函数, 保持剩下的顺序
+     */
+    template <typename Data>
+    void CompactHandlers(Data &l)
+    {
+        auto  &handlers = l.mHandlers;
+        size_t write    = 0;
+        for (size_t read = 0; read < handlers.size(); ++read)
+        {
+            if (handlers[read].mHandler == nullptr)
+                continue;
+            if (write != read)
+            {
+                handlers[write]                                     = handlers[read];
+                mRegistrations[handlers[write].mRegistration].index = static_cast<uint32_t>(write);
+            }
+            write++;
+        }
+        handlers.resize(write);
+        l.mTombstones = 0;
+    }
+
+    /**
+     * @brief 最外层的分发结束之后调用, 压缩注销的处理函数, 加入分发期间注册的处理函数
+     */
+    template <typename Data>
+    void FlushHandlers(Data &l)
+    {
+        if (l.mTombstones > 0)
+            CompactHandlers(l);
+
+        for (auto &handler : l.mRecursiveHandlers)
+        {
+            if (handler.mHandler != nullptr)
+                InsertHandler(l.mHandlers, handler);
+        }
+        l.mRecursiveHandlers.clear();
+    }
+
+    /**
+     * @brief 把注册对应的处理函数标记为注销, 释放注册, 不修改EventHandler上的链表
+     */
+    void ReleaseRegistration(uint32_t id);
+
+    /**
+     * @brief 注销handler中latched类型的所有注册
+     */
+    void UnregisterHandler(EventHandler *handler, bool latched);
+
+    EventTypeData      &GetEventData(uint32_t type);
+    LatchEventTypeData &GetLatchedData(uint32_t type);
+
+    void DispatchEvent(EventTypeData &l, const Event &e);
+    void DispatchUpEvents(vector<std::unique_ptr<Event>> &events, const LatchHandler &handler);
+    void DispatchDownEvents(vector<std::unique_ptr<Event>> &events, const LatchHandler &handler);
     void DispatchUpEvent(LatchEventTypeData &event_type, const Event &event);
     void DispatchDownEvent(LatchEventTypeData &event_type, const Event &event);
 
-    dict_map<uint64_t, EventTypeData>      mEvents;
-    dict_map<uint64_t, LatchEventTypeData> mLatchedEvents;
-    uint64_t                               mCookieCounter = 0;
+    // 按EventTypeRegistry的编号索引, 还没有注册过处理函数的类型是空指针
+    // 分发时处理函数可能会注册新的类型, 所以每个类型单独分配, 扩容时不会移动
+    vector<std::unique_ptr<EventTypeData>>      mEvents;
+    vector<std::unique_ptr<LatchEventTypeData>> mLatchedEvents;
+    uint64_t                                    mCookieCounter = 0;
+
+    // 所有处理函数的注册, 空闲的编号在mFreeRegistrations中复用
+    vector<Registration> mRegistrations;
+    vector<uint32_t>     mFreeRegistrations;
+
+    // Enqueue的事件, Dispatch期间入队的事件留到下一次Dispatch
+    EventArena mQueuedEvents;
+
+    // 其它线程入队的事件, 新的事件插入在头部
+    folly::AtomicLinkedList<ConcurrentEvent> mConcurrentEvents;
+    // 一次取出的事件, 顺序和入队的顺序相反
+    vector<ConcurrentEvent> mConcurrentBatch;
+    std::thread::id         mMainThread = std::this_thread::get_id();
 };
 } // namespace solis
@@ -8,6 +8,7 @@
 #include "core/solis_core.hpp"
 #include "core/base/object.hpp"
 #include "core/base/using.hpp"
+#include "core/base/delegate.hpp"
 
 #include "core/events/events.hpp"
 
@@ -30,16 +31,40 @@ public:
 
     virtual ~EventProperty() = default;
 
+    using Token = typename DelegateList<bool(const T &)>::Token;
+
     // operator +=
-    EventProperty &operator+=(std::function<bool(const T &)> &&function)
+    template <typename F>
+    EventProperty &operator+=(F &&function)
     {
-        auto &dummy = mCallbacks;
-        auto &vec   = dummy[static_cast<void *>(this)];
-        vec.push_back(std::move(function));
+        mCallbacks.Subscribe(std::forward<F>(function));
 
         return *this;
     }
 
+    /**
+     * @brief Subscribe is used to add a callback that can be removed later.
+     *
+     * @param function
+     * @return Token pass it to Unsubscribe, 0 is never returned
+     */
+    template <typename F>
+    Token Subscribe(F &&function)
+    {
+        return mCallbacks.Subscribe(std::forward<F>(function));
+    }
+
+    /**
+     * @brief Unsubscribe is used to remove a callback, it is safe to call from inside a callback.
+     *
+     * @param token
+     * @return true the callback was found and removed
+     */
+    bool Unsubscribe(Token token)
+    {
+        return mCallbacks.Unsubscribe(token);
+    }
+
     // operator()
     void operator()(const T &value)
     {
@@ -54,13 +79,7 @@ public:
      */
     void Invoke(const T &value)
     {
-        auto &dummy = mCallbacks;
-        auto &funs  = dummy[static_cast<void *>(this)];
-
-        for (auto &function : funs)
-        {
-            function(value);
-        }
+        mCallbacks.Invoke(value);
     }
 
     /**
@@ -84,13 +103,22 @@ public:
         mPostOnceEvents = std::make_unique<T>(value);
     }
 
+    /**
+     * @brief HasCallbacks is used to skip building events that nobody listens to.
+     *
+     */
+    bool HasCallbacks() const
+    {
+        return !mCallbacks.Empty();
+    }
+
     /**
      * @brief  Reset is used to reset the event.
      *
      */
     void Reset()
     {
-        mCallbacks.clear();
+        mCallbacks.Clear();
         mPostEvents.clear();
         mPostOnceEvents.reset();
     }
@@ -120,7 +148,8 @@ private:
         return true;
     }
 
-    dict_map<void *, std::vector<std::function<bool(const T &)>>> mCallbacks;
+    // the first callbacks are stored inline, invoking does no hashing and no allocation
+    DelegateList<bool(const T &)> mCallbacks;
 
     vector<T>          mPostEvents;
     std::unique_ptr<T> mPostOnceEvents;
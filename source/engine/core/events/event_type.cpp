@@ -0,0 +1,33 @@
+#include "core/events/event_type.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace solis {
+static std::mutex &EventTypeMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::unordered_map<uint64_t, uint32_t> &EventTypeIndices()
+{
+    static std::unordered_map<uint64_t, uint32_t> indices;
+    return indices;
+}
+
+uint32_t EventTypeRegistry::Register(uint64_t hash)
+{
+    std::lock_guard lock(EventTypeMutex());
+
+    auto &indices = EventTypeIndices();
+    auto  result  = indices.emplace(hash, static_cast<uint32_t>(indices.size()));
+    return result.first->second;
+}
+
+uint32_t EventTypeRegistry::Count()
+{
+    std::lock_guard lock(EventTypeMutex());
+    return static_cast<uint32_t>(EventTypeIndices().size());
+}
+} // namespace solis
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/solis_core.hpp"
+
+#include "ctti/type_id.hpp"
+
+namespace solis {
+/**
+ * @brief 事件类型的紧凑编号, 第一次用到一个事件类型时按顺序分配, 从0开始
+ * 编号表是全局的, 不同模块中的同一个类型得到相同的编号, EventManager用它直接索引处理函数表
+ */
+class SOLIS_CORE_API EventTypeRegistry
+{
+public:
+    /**
+     * @brief 类型哈希对应的编号, 没有时分配一个新的, 线程安全
+     */
+    static uint32_t Register(uint64_t hash);
+
+    /**
+     * @brief 已经分配的编号数量
+     */
+    static uint32_t Count();
+
+    /**
+     * @brief T的编号, 只在第一次调用时查表
+     */
+    template <typename T>
+    static uint32_t Index()
+    {
+        static const uint32_t index = Register(ctti::type_id<T>().hash());
+        return index;
+    }
+};
+} // namespace solis
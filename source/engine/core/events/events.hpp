@@ -1,9 +1,11 @@
 
 #pragma once
 
+#include <cassert>
 #include <filesystem>
 #include <iostream>
 #include <tuple>
+#include <unordered_map>
 
 #include "core/solis_core.hpp"
 
@@ -48,20 +50,27 @@ public:
     Events()          = default;
     virtual ~Events() = default;
 
+    /**
+     * @brief 先分发其它线程投递的事件, 再分发上一帧投递的事件, 然后一次性释放它们
+     * 分发期间投递的事件进入另一个缓冲, 在下一帧分发
+     */
     virtual void Update() override
     {
-        for (auto &[type, event] : mNextFrameEvents)
+        EventManager::DispatchConcurrent();
+
+        for (auto &[type, event] : mNextFrameEvents.Swap())
         {
             EventManager::DispatchInline(type, *event);
-            delete event;
         }
-        mNextFrameEvents.clear();
 
-        for (auto &[pair, event] : mPostOnceEvents)
+        mPostOnceSlots.clear();
+        for (auto &[type, event] : mPostOnceEvents.Swap())
         {
-            EventManager::DispatchInline(std::get<0>(pair), *event);
-            delete event;
+            EventManager::DispatchInline(type, *event);
         }
+
+        mNextFrameEvents.Release();
+        mPostOnceEvents.Release();
     }
 
     // SENT_EVENT
@@ -72,29 +81,56 @@ public:
         EventManager::DispatchInline(e);
     }
 
-    // POST_EVENT
+    // POST_EVENT, 可以在任何线程中调用, 其它线程投递的事件在下一次Update时分发
     template <typename T>
     std::enable_if_t<std::is_base_of_v<Event, T>, void>
     PostEvent(const T &e)
     {
-        Event *eptr = new T(e);
-        mNextFrameEvents.emplace_back(std::make_tuple(ctti::type_id<T>().hash(), eptr));
+        if (!IsMainThread())
+        {
+            EventManager::EnqueueConcurrent<T>(e);
+            return;
+        }
+        mNextFrameEvents.New<T>(e);
     }
 
-    // 多次POST只会记录最后一次
+    // 多次POST只会记录最后一次, 分发的顺序是第一次POST的顺序, 只能在主线程中调用
     template <typename T>
     std::enable_if_t<std::is_base_of_v<Event, T>, void>
     PostOnceEvent(const void *sender, const T &e)
     {
-        uint64_t type = ctti::type_id<T>().hash();
-        Event   *eptr = new T(e);
-        auto     pair = std::make_tuple(type, sender);
-        mPostOnceEvents.emplace(pair, eptr);
+        assert(IsMainThread() && "Events::PostOnceEvent: must be called on the main thread");
+
+        auto key = PostOnceKey(EventTypeRegistry::Index<T>(), sender);
+
+        auto it = mPostOnceSlots.find(key);
+        if (it == mPostOnceSlots.end())
+        {
+            mPostOnceSlots.emplace(key, mPostOnceEvents.New<T>(e));
+            return;
+        }
+
+        // 类型相同, 大小也相同, 直接在原来的位置上替换
+        auto slot = static_cast<T *>(it->second);
+        slot->~T();
+        ::new (slot) T(e);
     }
 
 private:
-    vector<std::tuple<uint64_t, Event *>>                 mNextFrameEvents;
-    dict_map<std::tuple<uint64_t, const void *>, Event *> mPostOnceEvents;
+    using PostOnceKey = std::tuple<uint32_t, const void *>;
+
+    struct PostOnceKeyHash
+    {
+        size_t operator()(const PostOnceKey &key) const
+        {
+            return std::hash<uint32_t>()(std::get<0>(key)) ^ (std::hash<const void *>()(std::get<1>(key)) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    EventArena mNextFrameEvents;
+    EventArena mPostOnceEvents;
+    // 这一帧PostOnceEvent的事件在帧内存中的位置
+    std::unordered_map<PostOnceKey, Event *, PostOnceKeyHash> mPostOnceSlots;
 };
 } // namespace events
 } // namespace solis
\ No newline at end of file
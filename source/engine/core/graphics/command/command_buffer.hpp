@@ -76,6 +76,28 @@ public:
         }
     }
 
+    /**
+     * @brief 绘制mesh的一级LOD, 级别来自LodSystem
+     *
+     * @param mesh
+     * @param lod 超过最大级数时使用最粗糙的一级
+     */
+    void Draw(const Mesh &mesh, uint32_t lod)
+    {
+        auto vertexBuffer = mesh.GetVertexBuffer();
+        assert(vertexBuffer && "Vertex buffer is null");
+        VkBuffer     vertexBuffers[] = {vertexBuffer->GetBuffer()};
+        VkDeviceSize offsets[]       = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+        auto indexBuffer = mesh.GetIndexBuffer();
+        assert(indexBuffer && "Index buffer is null");
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+        auto range = mesh.GetLod(lod);
+        vkCmdDrawIndexed(commandBuffer, range.indicesCount, 1, range.indexOffset, 0, 0);
+    }
+
     void Draw(const Model &model) const
     {
         BindPipelineDescriptorSet();
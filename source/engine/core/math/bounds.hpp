@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+
+#include "core/solis_core.hpp"
+#include "core/base/using.hpp"
+
+#include "core/math/mat.hpp"
+#include "core/math/math.hpp"
+
+namespace solis {
+/**
+ * @brief 轴对齐包围盒, 默认是一个空的包围盒(min > max), 合并任何点之后才有效
+ */
+struct AABB
+{
+    math::vec3 min{FLT_MAX};
+    math::vec3 max{-FLT_MAX};
+
+    AABB() = default;
+    AABB(const math::vec3 &min, const math::vec3 &max) :
+        min(min), max(max)
+    {
+    }
+
+    bool IsValid() const
+    {
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+
+    void Merge(const math::vec3 &point)
+    {
+        min = math::min(min, point);
+        max = math::max(max, point);
+    }
+
+    void Merge(const AABB &other)
+    {
+        min = math::min(min, other.min);
+        max = math::max(max, other.max);
+    }
+
+    static AABB Union(const AABB &a, const AABB &b)
+    {
+        return AABB(math::min(a.min, b.min), math::max(a.max, b.max));
+    }
+
+    math::vec3 Center() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    /**
+     * @brief 半边长
+     */
+    math::vec3 Extent() const
+    {
+        return (max - min) * 0.5f;
+    }
+
+    float SurfaceArea() const
+    {
+        auto d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    AABB Expanded(float margin) const
+    {
+        return AABB(min - math::vec3(margin), max + math::vec3(margin));
+    }
+
+    bool Contains(const AABB &other) const
+    {
+        return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+               max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+    }
+
+    bool Contains(const math::vec3 &point) const
+    {
+        return min.x <= point.x && min.y <= point.y && min.z <= point.z &&
+               max.x >= point.x && max.y >= point.y && max.z >= point.z;
+    }
+
+    bool Overlaps(const AABB &other) const
+    {
+        return min.x <= other.max.x && min.y <= other.max.y && min.z <= other.max.z &&
+               max.x >= other.min.x && max.y >= other.min.y && max.z >= other.min.z;
+    }
+
+    /**
+     * @brief 点到包围盒的距离的平方, 点在包围盒内时是0
+     */
+    float DistanceSquared(const math::vec3 &point) const
+    {
+        auto d = math::max(math::max(min - point, point - max), math::vec3(0.0f));
+        return math::dot(d, d);
+    }
+
+    /**
+     * @brief 变换之后的包围盒, 按中心和半边长的绝对值矩阵计算, 不需要变换8个顶点
+     */
+    AABB Transformed(const math::mat4 &matrix) const
+    {
+        auto center = math::vec3(matrix * math::vec4(Center(), 1.0f));
+        auto extent = Extent();
+
+        math::vec3 worldExtent;
+        for (int row = 0; row < 3; ++row)
+        {
+            worldExtent[row] = std::abs(matrix[0][row]) * extent.x + std::abs(matrix[1][row]) * extent.y + std::abs(matrix[2][row]) * extent.z;
+        }
+        return AABB(center - worldExtent, center + worldExtent);
+    }
+};
+
+/**
+ * @brief 射线, 只有[0, maxDistance]之间的部分参与相交测试, direction不需要归一化
+ */
+struct Ray
+{
+    math::vec3 origin{0.0f};
+    math::vec3 direction{0.0f, 0.0f, 1.0f};
+    float      maxDistance = FLT_MAX;
+
+    math::vec3 At(float t) const
+    {
+        return origin + direction * t;
+    }
+
+    /**
+     * @brief 射线和包围盒的slab测试
+     *
+     * @param box
+     * @param invDirection 1 / direction, 多次测试时预先计算
+     * @param tEnter 输出进入包围盒时的t, 起点在包围盒内时是0
+     * @return true 在[0, maxDistance]内相交
+     */
+    bool Intersects(const AABB &box, const math::vec3 &invDirection, float &tEnter) const
+    {
+        auto t0 = (box.min - origin) * invDirection;
+        auto t1 = (box.max - origin) * invDirection;
+
+        auto tMin = math::min(t0, t1);
+        auto tMax = math::max(t0, t1);
+
+        tEnter     = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+        float tExit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+        return tEnter <= tExit;
+    }
+};
+
+/**
+ * @brief 视锥体的6个平面, 法线指向内部, 平面方程 dot(n, p) + d >= 0 表示在内侧
+ */
+struct Frustum
+{
+    enum Plane
+    {
+        Left,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        Count
+    };
+
+    math::vec4 planes[Count];
+
+    /**
+     * @brief 从 projection * view 矩阵中提取平面(Gribb-Hartmann), 平面已经归一化
+     * 深度范围和glm的设置一致, 定义了GLM_FORCE_DEPTH_ZERO_TO_ONE时是[0, 1], 否则是[-1, 1]
+     */
+    static Frustum FromMatrix(const math::mat4 &viewProjection)
+    {
+        auto row = [&](int index) {
+            return math::vec4(viewProjection[0][index], viewProjection[1][index], viewProjection[2][index], viewProjection[3][index]);
+        };
+
+        Frustum frustum;
+        frustum.planes[Left]   = row(3) + row(0);
+        frustum.planes[Right]  = row(3) - row(0);
+        frustum.planes[Bottom] = row(3) + row(1);
+        frustum.planes[Top]    = row(3) - row(1);
+#if defined(GLM_FORCE_DEPTH_ZERO_TO_ONE)
+        frustum.planes[Near] = row(2);
+#else
+        frustum.planes[Near] = row(3) + row(2);
+#endif
+        frustum.planes[Far] = row(3) - row(2);
+
+        for (auto &plane : frustum.planes)
+        {
+            plane /= math::length(math::vec3(plane));
+        }
+        return frustum;
+    }
+
+    enum class Result
+    {
+        Outside,
+        Intersect,
+        Inside
+    };
+
+    /**
+     * @brief 包围盒和视锥体的关系, 保守测试, 靠近角落的包围盒可能被认为是相交
+     */
+    Result Classify(const AABB &box) const
+    {
+        auto center = box.Center();
+        auto extent = box.Extent();
+
+        auto result = Result::Inside;
+        for (auto &plane : planes)
+        {
+            auto normal   = math::vec3(plane);
+            auto distance = math::dot(normal, center) + plane.w;
+            auto radius   = math::dot(math::abs(normal), extent);
+            if (distance < -radius)
+            {
+                return Result::Outside;
+            }
+            if (distance < radius)
+            {
+                result = Result::Intersect;
+            }
+        }
+        return result;
+    }
+
+    bool Intersects(const AABB &box) const
+    {
+        return Classify(box) != Result::Outside;
+    }
+
+    bool Intersects(const math::vec3 &center, float radius) const
+    {
+        for (auto &plane : planes)
+        {
+            if (math::dot(math::vec3(plane), center) + plane.w < -radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+} // namespace solis
@@ -0,0 +1,316 @@
+#include "core/math/dynamic_bvh.hpp"
+
+namespace solis {
+DynamicBVH::DynamicBVH(float margin) :
+    mMargin(margin)
+{
+}
+
+uint32_t DynamicBVH::Insert(const AABB &aabb, void *userData)
+{
+    auto proxy = AllocateNode();
+
+    auto &node    = mNodes[proxy];
+    node.aabb     = aabb.Expanded(mMargin);
+    node.userData = userData;
+    node.height   = 0;
+
+    InsertLeaf(proxy);
+    mLeafCount++;
+    return proxy;
+}
+
+void DynamicBVH::Remove(uint32_t proxy)
+{
+    assert(proxy < mNodes.size() && mNodes[proxy].IsLeaf());
+
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    mLeafCount--;
+}
+
+bool DynamicBVH::Move(uint32_t proxy, const AABB &aabb)
+{
+    assert(proxy < mNodes.size() && mNodes[proxy].IsLeaf());
+
+    if (mNodes[proxy].aabb.Contains(aabb))
+    {
+        return false;
+    }
+
+    RemoveLeaf(proxy);
+    mNodes[proxy].aabb = aabb.Expanded(mMargin);
+    InsertLeaf(proxy);
+    return true;
+}
+
+void DynamicBVH::Clear()
+{
+    mNodes.clear();
+    mRoot      = NullNode;
+    mFreeList  = NullNode;
+    mLeafCount = 0;
+}
+
+uint32_t DynamicBVH::AllocateNode()
+{
+    if (mFreeList == NullNode)
+    {
+        mNodes.emplace_back();
+        return static_cast<uint32_t>(mNodes.size() - 1);
+    }
+
+    auto index = mFreeList;
+    mFreeList  = mNodes[index].parent;
+
+    mNodes[index] = Node();
+    return index;
+}
+
+void DynamicBVH::FreeNode(uint32_t index)
+{
+    auto &node    = mNodes[index];
+    node.parent   = mFreeList;
+    node.userData = nullptr;
+    node.height   = -1;
+    mFreeList     = index;
+}
+
+void DynamicBVH::InsertLeaf(uint32_t leaf)
+{
+    if (mRoot == NullNode)
+    {
+        mRoot                = leaf;
+        mNodes[leaf].parent = NullNode;
+        return;
+    }
+
+    // 沿着代价最小的方向向下找兄弟节点, 代价是新的父节点的表面积加上祖先增加的表面积
+    auto leafAABB = mNodes[leaf].aabb;
+    auto index    = mRoot;
+    while (!mNodes[index].IsLeaf())
+    {
+        auto &node   = mNodes[index];
+        auto  child1 = node.child1;
+        auto  child2 = node.child2;
+
+        auto area         = node.aabb.SurfaceArea();
+        auto combinedArea = AABB::Union(node.aabb, leafAABB).SurfaceArea();
+
+        // 在这里创建新的父节点的代价
+        auto cost = 2.0f * combinedArea;
+        // 继续向下时祖先增加的代价
+        auto inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto childCost = [&](uint32_t child) {
+            auto combined = AABB::Union(leafAABB, mNodes[child].aabb).SurfaceArea();
+            if (mNodes[child].IsLeaf())
+            {
+                return combined + inheritanceCost;
+            }
+            return combined - mNodes[child].aabb.SurfaceArea() + inheritanceCost;
+        };
+
+        auto cost1 = childCost(child1);
+        auto cost2 = childCost(child2);
+        if (cost < cost1 && cost < cost2)
+        {
+            break;
+        }
+        index = cost1 < cost2 ? child1 : child2;
+    }
+
+    auto sibling   = index;
+    auto oldParent = mNodes[sibling].parent;
+    auto newParent = AllocateNode();
+
+    mNodes[newParent].parent = oldParent;
+    mNodes[newParent].aabb   = AABB::Union(leafAABB, mNodes[sibling].aabb);
+    mNodes[newParent].height = mNodes[sibling].height + 1;
+    mNodes[newParent].child1 = sibling;
+    mNodes[newParent].child2 = leaf;
+    mNodes[sibling].parent   = newParent;
+    mNodes[leaf].parent      = newParent;
+
+    if (oldParent != NullNode)
+    {
+        if (mNodes[oldParent].child1 == sibling)
+        {
+            mNodes[oldParent].child1 = newParent;
+        }
+        else
+        {
+            mNodes[oldParent].child2 = newParent;
+        }
+    }
+    else
+    {
+        mRoot = newParent;
+    }
+
+    // 向上重新计算包围盒和高度, 顺便旋转
+    index = mNodes[leaf].parent;
+    while (index != NullNode)
+    {
+        index = Balance(index);
+
+        auto &node  = mNodes[index];
+        node.height = 1 + std::max(mNodes[node.child1].height, mNodes[node.child2].height);
+        node.aabb   = AABB::Union(mNodes[node.child1].aabb, mNodes[node.child2].aabb);
+
+        index = node.parent;
+    }
+}
+
+void DynamicBVH::RemoveLeaf(uint32_t leaf)
+{
+    if (leaf == mRoot)
+    {
+        mRoot = NullNode;
+        return;
+    }
+
+    auto parent      = mNodes[leaf].parent;
+    auto grandParent = mNodes[parent].parent;
+    auto sibling     = mNodes[parent].child1 == leaf ? mNodes[parent].child2 : mNodes[parent].child1;
+
+    if (grandParent == NullNode)
+    {
+        mRoot                   = sibling;
+        mNodes[sibling].parent = NullNode;
+        FreeNode(parent);
+        return;
+    }
+
+    // 用兄弟节点替换父节点
+    if (mNodes[grandParent].child1 == parent)
+    {
+        mNodes[grandParent].child1 = sibling;
+    }
+    else
+    {
+        mNodes[grandParent].child2 = sibling;
+    }
+    mNodes[sibling].parent = grandParent;
+    FreeNode(parent);
+
+    auto index = grandParent;
+    while (index != NullNode)
+    {
+        index = Balance(index);
+
+        auto &node  = mNodes[index];
+        node.aabb   = AABB::Union(mNodes[node.child1].aabb, mNodes[node.child2].aabb);
+        node.height = 1 + std::max(mNodes[node.child1].height, mNodes[node.child2].height);
+
+        index = node.parent;
+    }
+}
+
+uint32_t DynamicBVH::Balance(uint32_t iA)
+{
+    auto &A = mNodes[iA];
+    if (A.IsLeaf() || A.height < 2)
+    {
+        return iA;
+    }
+
+    auto iB = A.child1;
+    auto iC = A.child2;
+
+    auto balance = mNodes[iC].height - mNodes[iB].height;
+
+    // 把较高的子节点C(或者B)提升上来, A变成它的子节点, 它较高的子节点留在原位
+    auto rotate = [&](uint32_t iUp, uint32_t iOther, bool upIsChild2) {
+        auto &up = mNodes[iUp];
+        auto  iF = up.child1;
+        auto  iG = up.child2;
+
+        up.child1 = iA;
+        up.parent = A.parent;
+        A.parent  = iUp;
+
+        if (up.parent != NullNode)
+        {
+            if (mNodes[up.parent].child1 == iA)
+            {
+                mNodes[up.parent].child1 = iUp;
+            }
+            else
+            {
+                mNodes[up.parent].child2 = iUp;
+            }
+        }
+        else
+        {
+            mRoot = iUp;
+        }
+
+        // 较高的孙节点留在up下, 较矮的一个替换A中up的位置
+        auto iKeep = mNodes[iF].height > mNodes[iG].height ? iF : iG;
+        auto iMove = iKeep == iF ? iG : iF;
+
+        up.child2             = iKeep;
+        mNodes[iMove].parent = iA;
+        if (upIsChild2)
+        {
+            A.child2 = iMove;
+        }
+        else
+        {
+            A.child1 = iMove;
+        }
+
+        A.aabb   = AABB::Union(mNodes[iOther].aabb, mNodes[iMove].aabb);
+        A.height = 1 + std::max(mNodes[iOther].height, mNodes[iMove].height);
+
+        up.aabb   = AABB::Union(A.aabb, mNodes[iKeep].aabb);
+        up.height = 1 + std::max(A.height, mNodes[iKeep].height);
+        return iUp;
+    };
+
+    if (balance > 1)
+    {
+        return rotate(iC, iB, true);
+    }
+    if (balance < -1)
+    {
+        return rotate(iB, iC, false);
+    }
+    return iA;
+}
+
+void DynamicBVH::Validate() const
+{
+    if (mRoot != NullNode)
+    {
+        assert(mNodes[mRoot].parent == NullNode);
+        ValidateNode(mRoot);
+    }
+
+    size_t freeCount = 0;
+    for (auto index = mFreeList; index != NullNode; index = mNodes[index].parent)
+    {
+        freeCount++;
+    }
+    assert(mRoot == NullNode ? freeCount == mNodes.size() : freeCount + 2 * mLeafCount - 1 == mNodes.size());
+}
+
+uint32_t DynamicBVH::ValidateNode(uint32_t index) const
+{
+    auto &node = mNodes[index];
+    if (node.IsLeaf())
+    {
+        assert(node.height == 0);
+        return 1;
+    }
+
+    auto &child1 = mNodes[node.child1];
+    auto &child2 = mNodes[node.child2];
+    assert(child1.parent == index && child2.parent == index);
+    assert(node.height == 1 + std::max(child1.height, child2.height));
+    assert(std::abs(child1.height - child2.height) <= 1);
+    assert(node.aabb.Contains(child1.aabb) && node.aabb.Contains(child2.aabb));
+    return ValidateNode(node.child1) + ValidateNode(node.child2);
+}
+} // namespace solis
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+#include "core/base/const.hpp"
+
+#include "core/base/i_noncopyable.hpp"
+#include "core/math/bounds.hpp"
+
+namespace solis {
+/**
+ * @brief 动态的AABB树, 叶子存储放大过的包围盒(fat AABB)
+ * 物体在放大的包围盒内移动时不需要修改树, 移出之后才删除再插入, 插入时按表面积启发选择兄弟节点,
+ * 然后沿着父节点旋转保持平衡
+ *
+ * 查询都不分配内存, 遍历使用固定大小的栈
+ */
+class SOLIS_CORE_API DynamicBVH : public Object<DynamicBVH>, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(DynamicBVH)
+
+    inline static const uint32_t NullNode = 0xFFFFFFFF;
+
+    /**
+     * @param margin 叶子包围盒向外放大的距离
+     */
+    explicit DynamicBVH(float margin = DynamicBVHMargin);
+    virtual ~DynamicBVH() = default;
+
+    /**
+     * @brief 插入一个包围盒, O(log n)
+     *
+     * @param aabb
+     * @param userData
+     * @return uint32_t 代理编号, 在Remove之前不会改变
+     */
+    uint32_t Insert(const AABB &aabb, void *userData);
+
+    void Remove(uint32_t proxy);
+
+    /**
+     * @brief 更新代理的包围盒, 还在放大的包围盒内时什么都不做
+     *
+     * @return true 代理被重新插入了
+     */
+    bool Move(uint32_t proxy, const AABB &aabb);
+
+    void *GetUserData(uint32_t proxy) const
+    {
+        return mNodes[proxy].userData;
+    }
+
+    const AABB &GetFatAABB(uint32_t proxy) const
+    {
+        return mNodes[proxy].aabb;
+    }
+
+    size_t Count() const
+    {
+        return mLeafCount;
+    }
+
+    uint32_t GetHeight() const
+    {
+        return mRoot == NullNode ? 0 : static_cast<uint32_t>(mNodes[mRoot].height);
+    }
+
+    void Clear();
+
+    /**
+     * @brief 和aabb重叠的代理
+     *
+     * @param aabb
+     * @param callback bool(uint32_t proxy), 返回false停止查询
+     */
+    template <typename Func>
+    void QueryAABB(const AABB &aabb, Func &&callback) const
+    {
+        Stack stack;
+        stack.Push(mRoot);
+        while (!stack.Empty())
+        {
+            auto  index = stack.Pop();
+            auto &node  = mNodes[index];
+            if (!node.aabb.Overlaps(aabb))
+            {
+                continue;
+            }
+
+            if (node.IsLeaf())
+            {
+                if (!callback(index))
+                {
+                    return;
+                }
+            }
+            else
+            {
+                stack.Push(node.child1);
+                stack.Push(node.child2);
+            }
+        }
+    }
+
+    /**
+     * @brief 和视锥体相交的代理, 完全在视锥体内的子树不再测试平面
+     *
+     * @param frustum
+     * @param callback void(uint32_t proxy, bool inside), inside表示代理的包围盒完全在视锥体内
+     */
+    template <typename Func>
+    void QueryFrustum(const Frustum &frustum, Func &&callback) const
+    {
+        Stack stack;
+        stack.Push(mRoot);
+        while (!stack.Empty())
+        {
+            auto  index  = stack.Pop();
+            auto &node   = mNodes[index];
+            auto  result = frustum.Classify(node.aabb);
+            if (result == Frustum::Result::Outside)
+            {
+                continue;
+            }
+
+            if (result == Frustum::Result::Inside)
+            {
+                VisitLeaves(index, [&](uint32_t leaf) { callback(leaf, true); });
+            }
+            else if (node.IsLeaf())
+            {
+                callback(index, false);
+            }
+            else
+            {
+                stack.Push(node.child1);
+                stack.Push(node.child2);
+            }
+        }
+    }
+
+    /**
+     * @brief 沿着射线查询, 近的子节点先被访问
+     *
+     * @param ray
+     * @param callback float(uint32_t proxy, const Ray &ray), 返回新的maxDistance用于裁剪射线, 返回0停止查询
+     *        例如精确相交时返回命中的t, 没有命中时返回ray.maxDistance
+     */
+    template <typename Func>
+    void RayCast(const Ray &ray, Func &&callback) const
+    {
+        auto clipped      = ray;
+        auto invDirection = 1.0f / ray.direction;
+
+        Stack stack;
+        stack.Push(mRoot);
+        while (!stack.Empty())
+        {
+            auto  index = stack.Pop();
+            auto &node  = mNodes[index];
+
+            float tEnter = 0.0f;
+            if (!clipped.Intersects(node.aabb, invDirection, tEnter))
+            {
+                continue;
+            }
+
+            if (node.IsLeaf())
+            {
+                clipped.maxDistance = std::min(clipped.maxDistance, callback(index, static_cast<const Ray &>(clipped)));
+                if (clipped.maxDistance <= 0.0f)
+                {
+                    return;
+                }
+                continue;
+            }
+
+            // 后入栈的先被访问, 所以远的先入栈
+            float t1 = 0.0f, t2 = 0.0f;
+            bool  hit1 = clipped.Intersects(mNodes[node.child1].aabb, invDirection, t1);
+            bool  hit2 = clipped.Intersects(mNodes[node.child2].aabb, invDirection, t2);
+            if (hit1 && hit2)
+            {
+                stack.Push(t1 < t2 ? node.child2 : node.child1);
+                stack.Push(t1 < t2 ? node.child1 : node.child2);
+            }
+            else if (hit1)
+            {
+                stack.Push(node.child1);
+            }
+            else if (hit2)
+            {
+                stack.Push(node.child2);
+            }
+        }
+    }
+
+    /**
+     * @brief 离point最近的代理, 分支限界, 近的子节点先被访问
+     *
+     * @param point
+     * @param distance float(uint32_t proxy), 代理到point的精确距离的平方, 可以直接返回包围盒的距离
+     * @param maxDistance 只查找这个距离以内的代理
+     * @return uint32_t 没有找到时返回NullNode
+     */
+    template <typename Func>
+    uint32_t Nearest(const math::vec3 &point, Func &&distance, float maxDistance = FLT_MAX) const
+    {
+        auto     best      = NullNode;
+        float    bestSqr   = maxDistance == FLT_MAX ? FLT_MAX : maxDistance * maxDistance;
+
+        Stack stack;
+        stack.Push(mRoot);
+        while (!stack.Empty())
+        {
+            auto  index = stack.Pop();
+            auto &node  = mNodes[index];
+            if (node.aabb.DistanceSquared(point) >= bestSqr)
+            {
+                continue;
+            }
+
+            if (node.IsLeaf())
+            {
+                auto d = distance(index);
+                if (d < bestSqr)
+                {
+                    bestSqr = d;
+                    best    = index;
+                }
+                continue;
+            }
+
+            auto d1 = mNodes[node.child1].aabb.DistanceSquared(point);
+            auto d2 = mNodes[node.child2].aabb.DistanceSquared(point);
+            stack.Push(d1 < d2 ? node.child2 : node.child1);
+            stack.Push(d1 < d2 ? node.child1 : node.child2);
+        }
+        return best;
+    }
+
+    uint32_t Nearest(const math::vec3 &point, float maxDistance = FLT_MAX) const
+    {
+        return Nearest(
+            point, [&](uint32_t proxy) { return mNodes[proxy].aabb.DistanceSquared(point); }, maxDistance);
+    }
+
+    /**
+     * @brief 检查树的结构, 只在调试时使用
+     */
+    void Validate() const;
+
+private:
+    struct Node
+    {
+        AABB  aabb;
+        void *userData = nullptr;
+        // 在空闲链表中时是下一个空闲节点
+        uint32_t parent = NullNode;
+        uint32_t child1 = NullNode;
+        uint32_t child2 = NullNode;
+        // 叶子是0, 空闲节点是-1
+        int32_t height = -1;
+
+        bool IsLeaf() const
+        {
+            return child1 == NullNode;
+        }
+    };
+
+    /**
+     * @brief 遍历用的固定大小的栈, 平衡的树的深度远小于容量
+     */
+    struct Stack
+    {
+        std::array<uint32_t, 256> items;
+        uint32_t                  count = 0;
+
+        void Push(uint32_t index)
+        {
+            if (index != NullNode)
+            {
+                assert(count < items.size() && "DynamicBVH: traversal stack overflow");
+                items[count++] = index;
+            }
+        }
+
+        uint32_t Pop()
+        {
+            return items[--count];
+        }
+
+        bool Empty() const
+        {
+            return count == 0;
+        }
+    };
+
+    template <typename Func>
+    void VisitLeaves(uint32_t root, Func &&func) const
+    {
+        Stack stack;
+        stack.Push(root);
+        while (!stack.Empty())
+        {
+            auto  index = stack.Pop();
+            auto &node  = mNodes[index];
+            if (node.IsLeaf())
+            {
+                func(index);
+            }
+            else
+            {
+                stack.Push(node.child1);
+                stack.Push(node.child2);
+            }
+        }
+    }
+
+    uint32_t AllocateNode();
+
+    void FreeNode(uint32_t index);
+
+    void InsertLeaf(uint32_t leaf);
+
+    void RemoveLeaf(uint32_t leaf);
+
+    /**
+     * @brief 子树高度差大于1时旋转, 返回旋转之后这个位置上的节点
+     */
+    uint32_t Balance(uint32_t index);
+
+    uint32_t ValidateNode(uint32_t index) const;
+
+    vector<Node> mNodes;
+    uint32_t     mRoot      = NullNode;
+    uint32_t     mFreeList  = NullNode;
+    size_t       mLeafCount = 0;
+    float        mMargin    = 0.0f;
+};
+} // namespace solis
@@ -0,0 +1,260 @@
+#include "core/math/frustum_culler.hpp"
+
+#include <bit>
+
+#include "core/math/simd.hpp"
+
+namespace solis {
+void FrustumCuller::Clear()
+{
+    mBoxCenterX.clear();
+    mBoxCenterY.clear();
+    mBoxCenterZ.clear();
+    mBoxExtentX.clear();
+    mBoxExtentY.clear();
+    mBoxExtentZ.clear();
+    mBoxIds.clear();
+
+    mSphereX.clear();
+    mSphereY.clear();
+    mSphereZ.clear();
+    mSphereRadius.clear();
+    mSphereIds.clear();
+}
+
+void FrustumCuller::AddBox(const AABB &box, uint32_t id)
+{
+    auto center = box.Center();
+    auto extent = box.Extent();
+    mBoxCenterX.push_back(center.x);
+    mBoxCenterY.push_back(center.y);
+    mBoxCenterZ.push_back(center.z);
+    mBoxExtentX.push_back(extent.x);
+    mBoxExtentY.push_back(extent.y);
+    mBoxExtentZ.push_back(extent.z);
+    mBoxIds.push_back(id);
+}
+
+void FrustumCuller::AddSphere(const math::vec3 &center, float radius, uint32_t id)
+{
+    mSphereX.push_back(center.x);
+    mSphereY.push_back(center.y);
+    mSphereZ.push_back(center.z);
+    mSphereRadius.push_back(radius);
+    mSphereIds.push_back(id);
+}
+
+void FrustumCuller::Cull(const Frustum &frustum, vector<uint32_t> &visible) const
+{
+    visible.reserve(visible.size() + Count());
+
+    CullBoxes(frustum, visible);
+    CullSpheres(frustum, visible);
+}
+
+/**
+ * @brief mask中为0的位对应的id是可见的
+ */
+static inline void AppendVisible(uint32_t outsideMask, uint32_t lanes, const uint32_t *ids, vector<uint32_t> &visible)
+{
+    auto mask = ~outsideMask & ((1u << lanes) - 1);
+    while (mask != 0)
+    {
+        visible.push_back(ids[std::countr_zero(mask)]);
+        mask &= mask - 1;
+    }
+}
+
+void FrustumCuller::CullBoxes(const Frustum &frustum, vector<uint32_t> &visible) const
+{
+    auto   count = mBoxIds.size();
+    size_t i     = 0;
+
+    // 包围盒在平面法线方向上的投影半径是 dot(abs(n), extent), 中心距离加上半径小于0就在平面外
+#if defined(SOLIS_SIMD_AVX)
+    {
+        __m256 n[Frustum::Count][4], a[Frustum::Count][3];
+        for (int p = 0; p < Frustum::Count; ++p)
+        {
+            auto &plane = frustum.planes[p];
+            for (int c = 0; c < 4; ++c)
+            {
+                n[p][c] = _mm256_set1_ps(plane[c]);
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                a[p][c] = _mm256_set1_ps(std::abs(plane[c]));
+            }
+        }
+
+        const auto zero = _mm256_setzero_ps();
+        for (; i + 8 <= count; i += 8)
+        {
+            auto cx = _mm256_loadu_ps(mBoxCenterX.data() + i);
+            auto cy = _mm256_loadu_ps(mBoxCenterY.data() + i);
+            auto cz = _mm256_loadu_ps(mBoxCenterZ.data() + i);
+            auto ex = _mm256_loadu_ps(mBoxExtentX.data() + i);
+            auto ey = _mm256_loadu_ps(mBoxExtentY.data() + i);
+            auto ez = _mm256_loadu_ps(mBoxExtentZ.data() + i);
+
+            auto outside = _mm256_setzero_ps();
+            for (int p = 0; p < Frustum::Count; ++p)
+            {
+                auto distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(n[p][0], cx), _mm256_mul_ps(n[p][1], cy)),
+                                              _mm256_add_ps(_mm256_mul_ps(n[p][2], cz), n[p][3]));
+                auto radius   = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[p][0], ex), _mm256_mul_ps(a[p][1], ey)), _mm256_mul_ps(a[p][2], ez));
+                outside       = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+            }
+            AppendVisible(static_cast<uint32_t>(_mm256_movemask_ps(outside)), 8, mBoxIds.data() + i, visible);
+        }
+    }
+#endif
+
+#if defined(SOLIS_SIMD_SSE)
+    {
+        __m128 n[Frustum::Count][4], a[Frustum::Count][3];
+        for (int p = 0; p < Frustum::Count; ++p)
+        {
+            auto &plane = frustum.planes[p];
+            for (int c = 0; c < 4; ++c)
+            {
+                n[p][c] = _mm_set1_ps(plane[c]);
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                a[p][c] = _mm_set1_ps(std::abs(plane[c]));
+            }
+        }
+
+        const auto zero = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4)
+        {
+            auto cx = _mm_loadu_ps(mBoxCenterX.data() + i);
+            auto cy = _mm_loadu_ps(mBoxCenterY.data() + i);
+            auto cz = _mm_loadu_ps(mBoxCenterZ.data() + i);
+            auto ex = _mm_loadu_ps(mBoxExtentX.data() + i);
+            auto ey = _mm_loadu_ps(mBoxExtentY.data() + i);
+            auto ez = _mm_loadu_ps(mBoxExtentZ.data() + i);
+
+            auto outside = _mm_setzero_ps();
+            for (int p = 0; p < Frustum::Count; ++p)
+            {
+                auto distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n[p][0], cx), _mm_mul_ps(n[p][1], cy)),
+                                           _mm_add_ps(_mm_mul_ps(n[p][2], cz), n[p][3]));
+                auto radius   = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[p][0], ex), _mm_mul_ps(a[p][1], ey)), _mm_mul_ps(a[p][2], ez));
+                outside       = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+            }
+            AppendVisible(static_cast<uint32_t>(_mm_movemask_ps(outside)), 4, mBoxIds.data() + i, visible);
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        bool outside = false;
+        for (auto &plane : frustum.planes)
+        {
+            auto distance = plane.x * mBoxCenterX[i] + plane.y * mBoxCenterY[i] + (plane.z * mBoxCenterZ[i] + plane.w);
+            auto radius   = std::abs(plane.x) * mBoxExtentX[i] + std::abs(plane.y) * mBoxExtentY[i] + std::abs(plane.z) * mBoxExtentZ[i];
+            outside |= distance + radius < 0.0f;
+        }
+        if (!outside)
+        {
+            visible.push_back(mBoxIds[i]);
+        }
+    }
+}
+
+void FrustumCuller::CullSpheres(const Frustum &frustum, vector<uint32_t> &visible) const
+{
+    auto   count = mSphereIds.size();
+    size_t i     = 0;
+
+#if defined(SOLIS_SIMD_AVX)
+    {
+        __m256 n[Frustum::Count][4];
+        for (int p = 0; p < Frustum::Count; ++p)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                n[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+            }
+        }
+
+        const auto zero = _mm256_setzero_ps();
+        for (; i + 8 <= count; i += 8)
+        {
+            auto cx = _mm256_loadu_ps(mSphereX.data() + i);
+            auto cy = _mm256_loadu_ps(mSphereY.data() + i);
+            auto cz = _mm256_loadu_ps(mSphereZ.data() + i);
+            auto r  = _mm256_loadu_ps(mSphereRadius.data() + i);
+
+            auto outside = _mm256_setzero_ps();
+            for (int p = 0; p < Frustum::Count; ++p)
+            {
+                auto distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(n[p][0], cx), _mm256_mul_ps(n[p][1], cy)),
+                                              _mm256_add_ps(_mm256_mul_ps(n[p][2], cz), n[p][3]));
+                outside       = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, r), zero, _CMP_LT_OQ));
+            }
+            AppendVisible(static_cast<uint32_t>(_mm256_movemask_ps(outside)), 8, mSphereIds.data() + i, visible);
+        }
+    }
+#endif
+
+#if defined(SOLIS_SIMD_SSE)
+    {
+        __m128 n[Frustum::Count][4];
+        for (int p = 0; p < Frustum::Count; ++p)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                n[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+            }
+        }
+
+        const auto zero = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4)
+        {
+            auto cx = _mm_loadu_ps(mSphereX.data() + i);
+            auto cy = _mm_loadu_ps(mSphereY.data() + i);
+            auto cz = _mm_loadu_ps(mSphereZ.data() + i);
+            auto r  = _mm_loadu_ps(mSphereRadius.data() + i);
+
+            auto outside = _mm_setzero_ps();
+            for (int p = 0; p < Frustum::Count; ++p)
+            {
+                auto distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n[p][0], cx), _mm_mul_ps(n[p][1], cy)),
+                                           _mm_add_ps(_mm_mul_ps(n[p][2], cz), n[p][3]));
+                outside       = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, r), zero));
+            }
+            AppendVisible(static_cast<uint32_t>(_mm_movemask_ps(outside)), 4, mSphereIds.data() + i, visible);
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        bool outside = false;
+        for (auto &plane : frustum.planes)
+        {
+            auto distance = plane.x * mSphereX[i] + plane.y * mSphereY[i] + (plane.z * mSphereZ[i] + plane.w);
+            outside |= distance + mSphereRadius[i] < 0.0f;
+        }
+        if (!outside)
+        {
+            visible.push_back(mSphereIds[i]);
+        }
+    }
+}
+
+const char *FrustumCuller::GetSimdName()
+{
+#if defined(SOLIS_SIMD_AVX)
+    return "AVX";
+#elif defined(SOLIS_SIMD_SSE)
+    return "SSE";
+#else
+    return "Scalar";
+#endif
+}
+} // namespace solis
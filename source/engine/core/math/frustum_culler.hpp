@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+#include "core/base/i_noncopyable.hpp"
+#include "core/math/bounds.hpp"
+
+namespace solis {
+/**
+ * @brief 批量的视锥体剔除, 包围盒和包围球按分量分开存储(SoA)
+ * AVX一次测试8个, SSE一次4个, 剩下的标量计算, 结果和Frustum::Intersects一致
+ *
+ * 每帧Clear之后重新Add, 容量会被保留, 稳定之后不再分配内存
+ */
+class SOLIS_CORE_API FrustumCuller : public Object<FrustumCuller>, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(FrustumCuller)
+
+    FrustumCuller()          = default;
+    virtual ~FrustumCuller() = default;
+
+    void Clear();
+
+    void AddBox(const AABB &box, uint32_t id);
+
+    void AddSphere(const math::vec3 &center, float radius, uint32_t id);
+
+    /**
+     * @brief 等待测试的包围盒和包围球的数量
+     */
+    size_t Count() const
+    {
+        return mBoxIds.size() + mSphereIds.size();
+    }
+
+    /**
+     * @brief 测试所有加入的包围盒和包围球, 和视锥体相交的id按加入的顺序追加到visible后面
+     * 包围盒在前, 包围球在后
+     *
+     * @param frustum
+     * @param visible
+     */
+    void Cull(const Frustum &frustum, vector<uint32_t> &visible) const;
+
+    static const char *GetSimdName();
+
+private:
+    void CullBoxes(const Frustum &frustum, vector<uint32_t> &visible) const;
+
+    void CullSpheres(const Frustum &frustum, vector<uint32_t> &visible) const;
+
+    vector<float>    mBoxCenterX;
+    vector<float>    mBoxCenterY;
+    vector<float>    mBoxCenterZ;
+    vector<float>    mBoxExtentX;
+    vector<float>    mBoxExtentY;
+    vector<float>    mBoxExtentZ;
+    vector<uint32_t> mBoxIds;
+
+    vector<float>    mSphereX;
+    vector<float>    mSphereY;
+    vector<float>    mSphereZ;
+    vector<float>    mSphereRadius;
+    vector<uint32_t> mSphereIds;
+};
+} // namespace solis
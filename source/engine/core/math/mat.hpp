@@ -1 +1,2 @@
-#include "glm/gtc/matrix_transform.hpp"
\ No newline at end of file
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
@@ -0,0 +1,275 @@
+#include "core/math/occlusion_buffer.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "core/base/job_system.hpp"
+#include "core/math/simd.hpp"
+
+namespace solis {
+// 块的边长, 也是并行光栅化的条带高度
+static const uint32_t OcclusionTileSize = 8;
+// w小于这个值的顶点被认为在相机后面
+static const float OcclusionMinW = 1e-5f;
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height) :
+    mWidth((std::max(width, 1u) + OcclusionTileSize - 1) / OcclusionTileSize * OcclusionTileSize),
+    mHeight((std::max(height, 1u) + OcclusionTileSize - 1) / OcclusionTileSize * OcclusionTileSize),
+    mTilesX(mWidth / OcclusionTileSize),
+    mTilesY(mHeight / OcclusionTileSize)
+{
+    mDepth.assign(static_cast<size_t>(mWidth) * mHeight, FLT_MAX);
+    mTileMax.assign(static_cast<size_t>(mTilesX) * mTilesY, FLT_MAX);
+}
+
+void OcclusionBuffer::Begin(const math::mat4 &viewProjection)
+{
+    mViewProjection = viewProjection;
+    mTriangles.clear();
+    std::fill(mDepth.begin(), mDepth.end(), FLT_MAX);
+    std::fill(mTileMax.begin(), mTileMax.end(), FLT_MAX);
+}
+
+void OcclusionBuffer::AddOccluder(std::span<const math::vec3> positions, std::span<const uint32_t> indices, const math::mat4 &world)
+{
+    auto matrix = mViewProjection * world;
+
+    // 变换到屏幕空间, xy是像素坐标, z是NDC深度, w保留用于判断是否在相机后面
+    mClipPositions.resize(positions.size());
+    auto width  = static_cast<float>(mWidth);
+    auto height = static_cast<float>(mHeight);
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        auto clip = matrix * math::vec4(positions[i], 1.0f);
+        if (clip.w > OcclusionMinW)
+        {
+            auto invW = 1.0f / clip.w;
+            clip      = math::vec4((clip.x * invW * 0.5f + 0.5f) * width, (clip.y * invW * 0.5f + 0.5f) * height, clip.z * invW, clip.w);
+        }
+        mClipPositions[i] = clip;
+    }
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        auto &v0 = mClipPositions[indices[i]];
+        auto &v1 = mClipPositions[indices[i + 1]];
+        auto &v2 = mClipPositions[indices[i + 2]];
+
+        // 穿过近平面的三角形直接丢弃, 少一个遮挡物只会让结果更保守
+        if (v0.w <= OcclusionMinW || v1.w <= OcclusionMinW || v2.w <= OcclusionMinW)
+        {
+            continue;
+        }
+        SetupTriangle(v0, v1, v2);
+    }
+}
+
+void OcclusionBuffer::SetupTriangle(const math::vec4 &v0, const math::vec4 &v1, const math::vec4 &v2)
+{
+    auto area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (std::abs(area) < 1e-6f)
+    {
+        return;
+    }
+
+    // 统一成逆时针, 三角形内部的边函数都是正的
+    math::vec3 p[3] = {math::vec3(v0), math::vec3(v1), math::vec3(v2)};
+    if (area < 0.0f)
+    {
+        std::swap(p[1], p[2]);
+        area = -area;
+    }
+
+    auto minX = std::min({p[0].x, p[1].x, p[2].x});
+    auto maxX = std::max({p[0].x, p[1].x, p[2].x});
+    auto minY = std::min({p[0].y, p[1].y, p[2].y});
+    auto maxY = std::max({p[0].y, p[1].y, p[2].y});
+
+    Triangle triangle;
+    // 先在浮点数上限制到屏幕范围, 靠近相机的顶点坐标可能非常大
+    auto width    = static_cast<float>(mWidth);
+    auto height   = static_cast<float>(mHeight);
+    triangle.minX = static_cast<int32_t>(std::clamp(minX, 0.0f, width));
+    triangle.minY = static_cast<int32_t>(std::clamp(minY, 0.0f, height));
+    triangle.maxX = std::min(static_cast<int32_t>(std::clamp(maxX, -1.0f, width)), static_cast<int32_t>(mWidth) - 1);
+    triangle.maxY = std::min(static_cast<int32_t>(std::clamp(maxY, -1.0f, height)), static_cast<int32_t>(mHeight) - 1);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+    {
+        return;
+    }
+
+    for (int e = 0; e < 3; ++e)
+    {
+        auto &from = p[e];
+        auto &to   = p[(e + 1) % 3];
+        auto  a    = from.y - to.y;
+        auto  b    = to.x - from.x;
+        triangle.edges[e][0] = a;
+        triangle.edges[e][1] = b;
+        triangle.edges[e][2] = -(a * from.x + b * from.y);
+    }
+
+    auto dz1  = p[1].z - p[0].z;
+    auto dz2  = p[2].z - p[0].z;
+    auto dzdx = (dz1 * (p[2].y - p[0].y) - dz2 * (p[1].y - p[0].y)) / area;
+    auto dzdy = (dz2 * (p[1].x - p[0].x) - dz1 * (p[2].x - p[0].x)) / area;
+
+    triangle.depth[0] = dzdx;
+    triangle.depth[1] = dzdy;
+    triangle.depth[2] = p[0].z - dzdx * p[0].x - dzdy * p[0].y + 0.5f * (std::abs(dzdx) + std::abs(dzdy));
+
+    mTriangles.push_back(triangle);
+}
+
+void OcclusionBuffer::Rasterize()
+{
+    JobSystem::Get()->ParallelFor(mTilesY, 1, [this](size_t begin, size_t end) {
+        for (auto band = begin; band < end; ++band)
+        {
+            RasterizeBand(static_cast<uint32_t>(band * OcclusionTileSize), static_cast<uint32_t>((band + 1) * OcclusionTileSize));
+        }
+    });
+}
+
+void OcclusionBuffer::RasterizeBand(uint32_t beginRow, uint32_t endRow)
+{
+    for (auto &triangle : mTriangles)
+    {
+        auto rowBegin = std::max<int32_t>(triangle.minY, static_cast<int32_t>(beginRow));
+        auto rowEnd   = std::min<int32_t>(triangle.maxY + 1, static_cast<int32_t>(endRow));
+        if (rowBegin >= rowEnd)
+        {
+            continue;
+        }
+
+        auto &e = triangle.edges;
+        auto &d = triangle.depth;
+
+        // 每行从4对齐的位置开始, 宽度是8的倍数, 所以不会越界
+        auto columnBegin = triangle.minX & ~3;
+        for (auto y = rowBegin; y < rowEnd; ++y)
+        {
+            auto  py  = static_cast<float>(y) + 0.5f;
+            auto *row = mDepth.data() + static_cast<size_t>(y) * mWidth;
+
+            float rowEdge[3] = {e[0][1] * py + e[0][2], e[1][1] * py + e[1][2], e[2][1] * py + e[2][2]};
+            float rowDepth   = d[1] * py + d[2];
+
+            auto x = columnBegin;
+#if defined(SOLIS_SIMD_SSE)
+            const auto offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const auto zero    = _mm_setzero_ps();
+            for (; x <= triangle.maxX; x += 4)
+            {
+                auto px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+
+                auto inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(e[0][0]), px), _mm_set1_ps(rowEdge[0])), zero);
+                inside      = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(e[1][0]), px), _mm_set1_ps(rowEdge[1])), zero));
+                inside      = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(e[2][0]), px), _mm_set1_ps(rowEdge[2])), zero));
+                if (_mm_movemask_ps(inside) == 0)
+                {
+                    continue;
+                }
+
+                auto depth   = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(d[0]), px), _mm_set1_ps(rowDepth));
+                auto current = _mm_loadu_ps(row + x);
+                auto closer  = _mm_min_ps(current, depth);
+                // inside ? closer : current
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, current)));
+            }
+#else
+            for (; x <= triangle.maxX; ++x)
+            {
+                auto px = static_cast<float>(x) + 0.5f;
+                if (e[0][0] * px + rowEdge[0] >= 0.0f && e[1][0] * px + rowEdge[1] >= 0.0f && e[2][0] * px + rowEdge[2] >= 0.0f)
+                {
+                    row[x] = std::min(row[x], d[0] * px + rowDepth);
+                }
+            }
+#endif
+        }
+    }
+
+    // 这一条带里的块的最大深度
+    auto tileRow = beginRow / OcclusionTileSize;
+    for (uint32_t tileX = 0; tileX < mTilesX; ++tileX)
+    {
+        float maxDepth = -FLT_MAX;
+        for (auto y = beginRow; y < endRow; ++y)
+        {
+            auto row = mDepth.data() + static_cast<size_t>(y) * mWidth + tileX * OcclusionTileSize;
+            maxDepth = std::max(maxDepth, *std::max_element(row, row + OcclusionTileSize));
+        }
+        mTileMax[tileRow * mTilesX + tileX] = maxDepth;
+    }
+}
+
+bool OcclusionBuffer::IsVisible(const AABB &box) const
+{
+    auto width  = static_cast<float>(mWidth);
+    auto height = static_cast<float>(mHeight);
+
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    float minDepth = FLT_MAX;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        math::vec3 position((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y, (corner & 4) ? box.max.z : box.min.z);
+
+        auto clip = mViewProjection * math::vec4(position, 1.0f);
+        if (clip.w <= OcclusionMinW)
+        {
+            return true;
+        }
+
+        auto invW = 1.0f / clip.w;
+        auto x    = (clip.x * invW * 0.5f + 0.5f) * width;
+        auto y    = (clip.y * invW * 0.5f + 0.5f) * height;
+        minX      = std::min(minX, x);
+        maxX      = std::max(maxX, x);
+        minY      = std::min(minY, y);
+        maxY      = std::max(maxY, y);
+        minDepth  = std::min(minDepth, clip.z * invW);
+    }
+
+    // 完全在屏幕外的交给视锥体剔除
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+    {
+        return true;
+    }
+
+    auto x0 = static_cast<uint32_t>(std::max(minX, 0.0f));
+    auto y0 = static_cast<uint32_t>(std::max(minY, 0.0f));
+    auto x1 = static_cast<uint32_t>(std::min(maxX, width - 1.0f));
+    auto y1 = static_cast<uint32_t>(std::min(maxY, height - 1.0f));
+
+    for (auto tileY = y0 / OcclusionTileSize; tileY <= y1 / OcclusionTileSize; ++tileY)
+    {
+        for (auto tileX = x0 / OcclusionTileSize; tileX <= x1 / OcclusionTileSize; ++tileX)
+        {
+            // 整块都比包围盒近
+            if (mTileMax[tileY * mTilesX + tileX] < minDepth)
+            {
+                continue;
+            }
+
+            auto rowBegin    = std::max(y0, tileY * OcclusionTileSize);
+            auto rowEnd      = std::min(y1, tileY * OcclusionTileSize + OcclusionTileSize - 1);
+            auto columnBegin = std::max(x0, tileX * OcclusionTileSize);
+            auto columnEnd   = std::min(x1, tileX * OcclusionTileSize + OcclusionTileSize - 1);
+            for (auto y = rowBegin; y <= rowEnd; ++y)
+            {
+                auto row = mDepth.data() + static_cast<size_t>(y) * mWidth;
+                for (auto x = columnBegin; x <= columnEnd; ++x)
+                {
+                    if (row[x] >= minDepth)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+} // namespace solis
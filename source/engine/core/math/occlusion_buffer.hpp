@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+#include "core/base/const.hpp"
+
+#include "core/base/i_noncopyable.hpp"
+#include "core/math/bounds.hpp"
+
+namespace solis {
+/**
+ * @brief 软件遮挡剔除用的低分辨率深度缓冲, 存储NDC深度, 越大越远
+ *
+ * 遮挡物的三角形写入像素中心被覆盖的像素, 写入的深度是像素范围内的最大深度
+ * 被遮挡物按包围盒投影覆盖的所有像素和最近的深度测试, 除了遮挡物轮廓上不到一个像素的误差, 被判断为遮挡的物体一定看不见
+ * 穿过近平面的三角形不会被光栅化, 穿过近平面的包围盒总是可见
+ *
+ * 光栅化按8行一条带在JobSystem上并行, 每一行用SSE一次处理4个像素
+ * 每8x8个像素记录一个最大深度, 测试时整块被遮挡的区域不需要逐像素比较
+ */
+class SOLIS_CORE_API OcclusionBuffer : public Object<OcclusionBuffer>, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(OcclusionBuffer)
+
+    /**
+     * @param width 会被向上取整到8的倍数
+     * @param height 会被向上取整到8的倍数
+     */
+    OcclusionBuffer(uint32_t width = OcclusionBufferWidth, uint32_t height = OcclusionBufferHeight);
+    virtual ~OcclusionBuffer() = default;
+
+    /**
+     * @brief 开始新的一帧, 清除深度和上一帧的遮挡物
+     *
+     * @param viewProjection
+     */
+    void Begin(const math::mat4 &viewProjection);
+
+    /**
+     * @brief 加入一个遮挡物, 三角形会被变换到屏幕空间, 在Rasterize时才写入深度
+     *
+     * @param positions 局部空间的顶点位置
+     * @param indices 每3个索引一个三角形, 正反面都会被光栅化
+     * @param world 局部到世界的矩阵
+     */
+    void AddOccluder(std::span<const math::vec3> positions, std::span<const uint32_t> indices, const math::mat4 &world);
+
+    /**
+     * @brief 光栅化所有加入的遮挡物, 然后计算每个块的最大深度
+     */
+    void Rasterize();
+
+    /**
+     * @brief 世界空间的包围盒是否可能可见, 必须在Rasterize之后调用, 可以在多个线程中同时调用
+     *
+     * @param box
+     * @return false 包围盒一定被遮挡
+     */
+    bool IsVisible(const AABB &box) const;
+
+    uint32_t GetWidth() const
+    {
+        return mWidth;
+    }
+
+    uint32_t GetHeight() const
+    {
+        return mHeight;
+    }
+
+    size_t GetTriangleCount() const
+    {
+        return mTriangles.size();
+    }
+
+    /**
+     * @brief 像素的深度, 没有被遮挡物覆盖时是FLT_MAX, 用于调试
+     */
+    float GetDepth(uint32_t x, uint32_t y) const
+    {
+        return mDepth[y * mWidth + x];
+    }
+
+private:
+    /**
+     * @brief 设置好的屏幕空间三角形, 边函数和深度平面都是 a * x + b * y + c, 在像素中心求值
+     * 三个边函数都大于等于0表示像素中心在三角形内
+     * 深度平面已经加上了半个像素的变化量, 是像素范围内的最大深度
+     */
+    struct Triangle
+    {
+        float   edges[3][3];
+        float   depth[3];
+        int32_t minX, minY, maxX, maxY;
+    };
+
+    void SetupTriangle(const math::vec4 &v0, const math::vec4 &v1, const math::vec4 &v2);
+
+    /**
+     * @brief 光栅化[beginRow, endRow)之间的像素, 不同的条带互相独立
+     */
+    void RasterizeBand(uint32_t beginRow, uint32_t endRow);
+
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mTilesX;
+    uint32_t mTilesY;
+
+    math::mat4 mViewProjection{1.0f};
+
+    vector<float> mDepth;
+    // 每个8x8块的最大深度
+    vector<float> mTileMax;
+
+    vector<Triangle>   mTriangles;
+    vector<math::vec4> mClipPositions;
+};
+} // namespace solis
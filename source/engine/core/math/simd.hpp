@@ -0,0 +1,17 @@
+#pragma once
+
+// 编译期选择SIMD指令集, 只在.cpp中包含, 不要暴露到公共头文件里
+
+#if defined(__AVX__)
+#    define SOLIS_SIMD_AVX
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define SOLIS_SIMD_SSE
+#endif
+
+#if defined(SOLIS_SIMD_AVX)
+#    include <immintrin.h>
+#elif defined(SOLIS_SIMD_SSE)
+#    include <emmintrin.h>
+#endif
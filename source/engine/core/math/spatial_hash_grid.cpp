@@ -0,0 +1,113 @@
+#include "core/math/spatial_hash_grid.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+
+#include "core/base/job_system.hpp"
+
+namespace solis {
+// 并行统计和写入时每个任务块的点数量
+static const size_t SpatialHashPointGrain = 2048;
+// 并行排序桶时每个任务块的桶数量
+static const size_t SpatialHashBucketGrain = 4096;
+// 最少的桶数量
+static const uint32_t SpatialHashMinBuckets = 64;
+// 不超过这个数量的桶用插入排序, 更大的桶(很多点在同一个格子里)用std::sort
+static const uint32_t SpatialHashInsertionSortSize = 16;
+
+SpatialHashGrid::SpatialHashGrid(float cellSize)
+{
+    SetCellSize(cellSize);
+}
+
+void SpatialHashGrid::SetCellSize(float cellSize)
+{
+    assert(cellSize > 0.0f && "SpatialHashGrid::SetCellSize: cell size must be positive");
+
+    mCellSize    = cellSize;
+    mInvCellSize = 1.0f / cellSize;
+}
+
+void SpatialHashGrid::Clear()
+{
+    mBucketCount = 1;
+    mBucketShift = 64;
+    mBucketStarts.assign(2, 0);
+    mSortedIds.clear();
+    mSortedPositions.clear();
+    mSortedCells.clear();
+}
+
+void SpatialHashGrid::Build(std::span<const math::vec3> positions)
+{
+    auto count = static_cast<uint32_t>(positions.size());
+
+    // 桶的数量是点数量的2倍左右, 平均每个非空的桶只有一两个点
+    mBucketCount = std::bit_ceil(std::max(count * 2, SpatialHashMinBuckets));
+    mBucketShift = 64 - std::countr_zero(mBucketCount);
+    mBucketStarts.assign(mBucketCount + 1, 0);
+    mPointBuckets.resize(count);
+    mSortedIds.resize(count);
+    mSortedPositions.resize(count);
+    mSortedCells.resize(count);
+
+    auto jobSystem = JobSystem::Get();
+
+    // 统计每个桶的点数量, 先放在下一个桶的位置上, 前缀和之后就是起始位置
+    jobSystem->ParallelFor(count, SpatialHashPointGrain, [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto bucket      = Hash(ToCell(positions[i]));
+            mPointBuckets[i] = bucket;
+            std::atomic_ref<uint32_t>(mBucketStarts[bucket + 1]).fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    for (uint32_t i = 0; i < mBucketCount; ++i)
+    {
+        mBucketStarts[i + 1] += mBucketStarts[i];
+    }
+
+    // 同一个桶内的写入顺序取决于线程的调度
+    mBucketCursors.assign(mBucketStarts.begin(), mBucketStarts.end() - 1);
+    jobSystem->ParallelFor(count, SpatialHashPointGrain, [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto slot        = std::atomic_ref<uint32_t>(mBucketCursors[mPointBuckets[i]]).fetch_add(1, std::memory_order_relaxed);
+            mSortedIds[slot] = static_cast<uint32_t>(i);
+        }
+    });
+
+    // 桶内按编号排序, 然后按排序之后的顺序复制位置和格子
+    jobSystem->ParallelFor(mBucketCount, SpatialHashBucketGrain, [&](size_t begin, size_t end) {
+        for (auto bucket = begin; bucket < end; ++bucket)
+        {
+            auto first = mBucketStarts[bucket];
+            auto last  = mBucketStarts[bucket + 1];
+            if (last - first > SpatialHashInsertionSortSize)
+            {
+                std::sort(mSortedIds.begin() + first, mSortedIds.begin() + last);
+            }
+            else
+            {
+                for (auto i = first + 1; i < last; ++i)
+                {
+                    auto id = mSortedIds[i];
+                    auto j  = i;
+                    for (; j > first && mSortedIds[j - 1] > id; --j)
+                    {
+                        mSortedIds[j] = mSortedIds[j - 1];
+                    }
+                    mSortedIds[j] = id;
+                }
+            }
+            for (auto i = first; i < last; ++i)
+            {
+                mSortedPositions[i] = positions[mSortedIds[i]];
+                mSortedCells[i]     = ToCell(mSortedPositions[i]);
+            }
+        }
+    });
+}
+} // namespace solis
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <span>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+#include "core/base/const.hpp"
+
+#include "core/base/i_noncopyable.hpp"
+#include "core/math/bounds.hpp"
+
+namespace solis {
+/**
+ * @brief 均匀的空间哈希网格, 每次Build都从点的位置完全重建, 适合大量快速移动的物体
+ *
+ * 格子坐标哈希到2的幂大小的桶表中, 用计数排序把点按桶连续存放: 先并行统计每个桶的数量,
+ * 前缀和得到每个桶的起始位置, 再并行写入, 最后每个桶内按编号排序, 所以结果和线程数无关
+ * 不同的格子可能落在同一个桶中, 查询时会比较点所在的格子(构建时保存), 不会重复返回
+ *
+ * 查询都不分配内存, 可以在多个线程中同时查询
+ */
+class SOLIS_CORE_API SpatialHashGrid : public Object<SpatialHashGrid>, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(SpatialHashGrid)
+
+    explicit SpatialHashGrid(float cellSize = SpatialHashCellSize);
+    virtual ~SpatialHashGrid() = default;
+
+    /**
+     * @brief 修改格子边长, 下一次Build时生效
+     */
+    void SetCellSize(float cellSize);
+
+    float GetCellSize() const
+    {
+        return mCellSize;
+    }
+
+    /**
+     * @brief 重建网格, 查询返回的是点在positions中的下标, 容量足够时不分配内存
+     */
+    void Build(std::span<const math::vec3> positions);
+
+    void Clear();
+
+    size_t Count() const
+    {
+        return mSortedIds.size();
+    }
+
+    /**
+     * @brief 到center的距离不超过radius的点
+     *
+     * @param callback bool(uint32_t index), 返回false停止查询
+     */
+    template <typename Func>
+    void QueryRadius(const math::vec3 &center, float radius, Func &&callback) const
+    {
+        auto radiusSquared = radius * radius;
+        Query(AABB(center - math::vec3(radius), center + math::vec3(radius)), [&](const math::vec3 &position) {
+            auto offset = position - center;
+            return math::dot(offset, offset) <= radiusSquared;
+        }, callback);
+    }
+
+    /**
+     * @brief 在包围盒内(包括边界)的点
+     *
+     * @param callback bool(uint32_t index), 返回false停止查询
+     */
+    template <typename Func>
+    void QueryAABB(const AABB &box, Func &&callback) const
+    {
+        Query(box, [&](const math::vec3 &position) { return box.Contains(position); }, callback);
+    }
+
+private:
+    struct Cell
+    {
+        int32_t x, y, z;
+
+        bool operator==(const Cell &other) const = default;
+    };
+
+    Cell ToCell(const math::vec3 &position) const
+    {
+        // 先在浮点数中限制范围, 避免转换成整数时溢出
+        auto scaled = math::clamp(math::floor(position * mInvCellSize), math::vec3(-CellLimit), math::vec3(CellLimit));
+        return {static_cast<int32_t>(scaled.x), static_cast<int32_t>(scaled.y), static_cast<int32_t>(scaled.z)};
+    }
+
+    uint32_t Hash(const Cell &cell) const
+    {
+        // 乘法的低位只取决于坐标的低位, 所以最后再混合一次, 取高位作为桶编号
+        auto hash = static_cast<uint32_t>(cell.x) * 73856093u ^ static_cast<uint32_t>(cell.y) * 19349663u ^ static_cast<uint32_t>(cell.z) * 83492791u;
+        return static_cast<uint32_t>((uint64_t(hash) * 0x9E3779B97F4A7C15ull) >> mBucketShift);
+    }
+
+    /**
+     * @brief 遍历box覆盖的格子, test通过的点交给callback
+     * 覆盖的格子比点还多时直接线性扫描所有的点
+     */
+    template <typename Test, typename Func>
+    void Query(const AABB &box, Test &&test, Func &&callback) const
+    {
+        if (mSortedIds.empty() || !(box.min.x <= box.max.x && box.min.y <= box.max.y && box.min.z <= box.max.z))
+        {
+            return;
+        }
+
+        auto lower = ToCell(box.min);
+        auto upper = ToCell(box.max);
+
+        auto cellCount = (double(upper.x) - lower.x + 1.0) * (double(upper.y) - lower.y + 1.0) * (double(upper.z) - lower.z + 1.0);
+        if (cellCount >= double(mSortedIds.size()))
+        {
+            for (size_t i = 0; i < mSortedIds.size(); ++i)
+            {
+                if (test(mSortedPositions[i]) && !callback(mSortedIds[i]))
+                {
+                    return;
+                }
+            }
+            return;
+        }
+
+        // 比较点所在的格子, 跳过落在同一个桶中的其它格子
+        for (auto z = lower.z; z <= upper.z; ++z)
+        {
+            for (auto y = lower.y; y <= upper.y; ++y)
+            {
+                for (auto x = lower.x; x <= upper.x; ++x)
+                {
+                    Cell cell{x, y, z};
+                    auto bucket = Hash(cell);
+                    for (auto i = mBucketStarts[bucket]; i < mBucketStarts[bucket + 1]; ++i)
+                    {
+                        auto &position = mSortedPositions[i];
+                        if (mSortedCells[i] == cell && test(position) && !callback(mSortedIds[i]))
+                        {
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // 格子坐标的范围, 远小于int32_t的范围, 循环时不会溢出
+    inline static const float CellLimit = float(1 << 30);
+
+    float mCellSize;
+    float mInvCellSize;
+
+    // 桶的数量, 2的幂, 哈希值右移mBucketShift位得到桶编号
+    uint32_t mBucketCount = 1;
+    uint32_t mBucketShift = 64;
+    // 每个桶在排序之后的数组中的起始位置, 最后一个元素是点的总数
+    vector<uint32_t> mBucketStarts{0, 0};
+    // 构建时每个桶的写入位置
+    vector<uint32_t> mBucketCursors;
+    // 每个点所在的桶
+    vector<uint32_t> mPointBuckets;
+
+    // 按桶排序之后的点
+    vector<uint32_t>   mSortedIds;
+    vector<math::vec3> mSortedPositions;
+    vector<Cell>       mSortedCells;
+};
+} // namespace solis
@@ -0,0 +1,190 @@
+#include "core/math/transform_soa.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "core/math/simd.hpp"
+
+namespace solis {
+// 分量数组的数量: 位置3, 旋转4, 缩放3
+static const size_t TransformSoAStreams = 10;
+// 每个分量数组的对齐, 也是容量的粒度
+static const size_t TransformSoAAlign = 8;
+
+TransformSoA::~TransformSoA()
+{
+    if (mData != nullptr)
+    {
+        operator delete[](mData, std::align_val_t(TransformSoAAlign * sizeof(float)));
+    }
+}
+
+void TransformSoA::Resize(size_t size)
+{
+    if (size > mCapacity)
+    {
+        auto capacity = std::max((size + TransformSoAAlign - 1) & ~(TransformSoAAlign - 1), mCapacity * 2);
+        auto data     = static_cast<float *>(operator new[](capacity * TransformSoAStreams * sizeof(float), std::align_val_t(TransformSoAAlign * sizeof(float))));
+
+        // 新的元素是单位变换
+        static const float Identity[TransformSoAStreams] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+        for (size_t stream = 0; stream < TransformSoAStreams; ++stream)
+        {
+            auto dst = data + stream * capacity;
+            if (mData != nullptr)
+            {
+                std::memcpy(dst, mData + stream * mCapacity, mSize * sizeof(float));
+            }
+            std::fill(dst + mSize, dst + capacity, Identity[stream]);
+        }
+
+        if (mData != nullptr)
+        {
+            operator delete[](mData, std::align_val_t(TransformSoAAlign * sizeof(float)));
+        }
+        mData     = data;
+        mCapacity = capacity;
+
+        mPositionX = mData + 0 * mCapacity;
+        mPositionY = mData + 1 * mCapacity;
+        mPositionZ = mData + 2 * mCapacity;
+        mRotationX = mData + 3 * mCapacity;
+        mRotationY = mData + 4 * mCapacity;
+        mRotationZ = mData + 5 * mCapacity;
+        mRotationW = mData + 6 * mCapacity;
+        mScaleX    = mData + 7 * mCapacity;
+        mScaleY    = mData + 8 * mCapacity;
+        mScaleZ    = mData + 9 * mCapacity;
+    }
+    mSize = size;
+}
+
+void TransformSoA::ComposeScalar(size_t begin, size_t end, math::mat4 *out) const
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        float x = mRotationX[i], y = mRotationY[i], z = mRotationZ[i], w = mRotationW[i];
+        float xx = x * x, yy = y * y, zz = z * z;
+        float xy = x * y, xz = x * z, yz = y * z;
+        float wx = w * x, wy = w * y, wz = w * z;
+
+        auto &m = out[i];
+        m[0]    = math::vec4((1.0f - 2.0f * (yy + zz)) * mScaleX[i], 2.0f * (xy + wz) * mScaleX[i], 2.0f * (xz - wy) * mScaleX[i], 0.0f);
+        m[1]    = math::vec4(2.0f * (xy - wz) * mScaleY[i], (1.0f - 2.0f * (xx + zz)) * mScaleY[i], 2.0f * (yz + wx) * mScaleY[i], 0.0f);
+        m[2]    = math::vec4(2.0f * (xz + wy) * mScaleZ[i], 2.0f * (yz - wx) * mScaleZ[i], (1.0f - 2.0f * (xx + yy)) * mScaleZ[i], 0.0f);
+        m[3]    = math::vec4(mPositionX[i], mPositionY[i], mPositionZ[i], 1.0f);
+    }
+}
+
+#if defined(SOLIS_SIMD_AVX) || defined(SOLIS_SIMD_SSE)
+/**
+ * @brief 4个矩阵同一列的分量转置成4个矩阵各自的一列
+ */
+static inline void StoreColumn(__m128 r0, __m128 r1, __m128 r2, __m128 r3, math::mat4 *out, int column)
+{
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(&out[0][column][0], r0);
+    _mm_storeu_ps(&out[1][column][0], r1);
+    _mm_storeu_ps(&out[2][column][0], r2);
+    _mm_storeu_ps(&out[3][column][0], r3);
+}
+#endif
+
+void TransformSoA::Compose(size_t begin, size_t end, math::mat4 *out) const
+{
+    auto i = begin;
+
+#if defined(SOLIS_SIMD_AVX)
+    const auto one  = _mm256_set1_ps(1.0f);
+    const auto two  = _mm256_set1_ps(2.0f);
+    const auto zero = _mm_setzero_ps();
+    const auto w1   = _mm_set1_ps(1.0f);
+    for (; i + 8 <= end; i += 8)
+    {
+        auto x = _mm256_loadu_ps(mRotationX + i);
+        auto y = _mm256_loadu_ps(mRotationY + i);
+        auto z = _mm256_loadu_ps(mRotationZ + i);
+        auto w = _mm256_loadu_ps(mRotationW + i);
+
+        auto xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+        auto xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+        auto wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+        auto sx = _mm256_loadu_ps(mScaleX + i);
+        auto sy = _mm256_loadu_ps(mScaleY + i);
+        auto sz = _mm256_loadu_ps(mScaleZ + i);
+
+        __m256 c[3][3];
+        c[0][0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx);
+        c[0][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+        c[0][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+        c[1][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+        c[1][1] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy);
+        c[1][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+        c[2][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+        c[2][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+        c[2][2] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz);
+
+        __m256 p[3] = {_mm256_loadu_ps(mPositionX + i), _mm256_loadu_ps(mPositionY + i), _mm256_loadu_ps(mPositionZ + i)};
+
+        // 低4个和高4个矩阵分别转置写入
+        for (int column = 0; column < 3; ++column)
+        {
+            StoreColumn(_mm256_castps256_ps128(c[column][0]), _mm256_castps256_ps128(c[column][1]), _mm256_castps256_ps128(c[column][2]), zero, out + i, column);
+            StoreColumn(_mm256_extractf128_ps(c[column][0], 1), _mm256_extractf128_ps(c[column][1], 1), _mm256_extractf128_ps(c[column][2], 1), zero, out + i + 4, column);
+        }
+        StoreColumn(_mm256_castps256_ps128(p[0]), _mm256_castps256_ps128(p[1]), _mm256_castps256_ps128(p[2]), w1, out + i, 3);
+        StoreColumn(_mm256_extractf128_ps(p[0], 1), _mm256_extractf128_ps(p[1], 1), _mm256_extractf128_ps(p[2], 1), w1, out + i + 4, 3);
+    }
+#endif
+
+#if defined(SOLIS_SIMD_SSE)
+    const auto one4  = _mm_set1_ps(1.0f);
+    const auto two4  = _mm_set1_ps(2.0f);
+    const auto zero4 = _mm_setzero_ps();
+    for (; i + 4 <= end; i += 4)
+    {
+        auto x = _mm_loadu_ps(mRotationX + i);
+        auto y = _mm_loadu_ps(mRotationY + i);
+        auto z = _mm_loadu_ps(mRotationZ + i);
+        auto w = _mm_loadu_ps(mRotationW + i);
+
+        auto xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        auto xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        auto wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        auto sx = _mm_loadu_ps(mScaleX + i);
+        auto sy = _mm_loadu_ps(mScaleY + i);
+        auto sz = _mm_loadu_ps(mScaleZ + i);
+
+        StoreColumn(_mm_mul_ps(_mm_sub_ps(one4, _mm_mul_ps(two4, _mm_add_ps(yy, zz))), sx),
+                    _mm_mul_ps(_mm_mul_ps(two4, _mm_add_ps(xy, wz)), sx),
+                    _mm_mul_ps(_mm_mul_ps(two4, _mm_sub_ps(xz, wy)), sx),
+                    zero4, out + i, 0);
+        StoreColumn(_mm_mul_ps(_mm_mul_ps(two4, _mm_sub_ps(xy, wz)), sy),
+                    _mm_mul_ps(_mm_sub_ps(one4, _mm_mul_ps(two4, _mm_add_ps(xx, zz))), sy),
+                    _mm_mul_ps(_mm_mul_ps(two4, _mm_add_ps(yz, wx)), sy),
+                    zero4, out + i, 1);
+        StoreColumn(_mm_mul_ps(_mm_mul_ps(two4, _mm_add_ps(xz, wy)), sz),
+                    _mm_mul_ps(_mm_mul_ps(two4, _mm_sub_ps(yz, wx)), sz),
+                    _mm_mul_ps(_mm_sub_ps(one4, _mm_mul_ps(two4, _mm_add_ps(xx, yy))), sz),
+                    zero4, out + i, 2);
+        StoreColumn(_mm_loadu_ps(mPositionX + i), _mm_loadu_ps(mPositionY + i), _mm_loadu_ps(mPositionZ + i), one4, out + i, 3);
+    }
+#endif
+
+    ComposeScalar(i, end, out);
+}
+
+const char *TransformSoA::GetSimdName()
+{
+#if defined(SOLIS_SIMD_AVX)
+    return "AVX";
+#elif defined(SOLIS_SIMD_SSE)
+    return "SSE";
+#else
+    return "Scalar";
+#endif
+}
+} // namespace solis
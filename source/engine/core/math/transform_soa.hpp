@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+#include "core/base/i_noncopyable.hpp"
+#include "core/math/mat.hpp"
+#include "core/math/math.hpp"
+
+namespace solis {
+/**
+ * @brief 按结构体数组(SoA)存储的位置, 四元数旋转和缩放, 每个分量一个32字节对齐的数组
+ * 用于批量地把TRS组合成局部矩阵, AVX一次8个, SSE一次4个, 剩下的标量计算
+ *
+ * 没有AVX/SSE的平台只有标量实现, 结果和glm的 translate * mat4_cast(quat) * scale 一致
+ */
+class SOLIS_CORE_API TransformSoA : public Object<TransformSoA>, public INonCopyable
+{
+public:
+    OBJECT_NEW_DELETE(TransformSoA)
+
+    TransformSoA() = default;
+    virtual ~TransformSoA();
+
+    /**
+     * @brief 改变元素数量, 扩容时已有的数据会被保留, 新的元素是单位变换
+     *
+     * @param size
+     */
+    void Resize(size_t size);
+
+    size_t Size() const
+    {
+        return mSize;
+    }
+
+    void Set(size_t index, const math::vec3 &position, const math::quat &rotation, const math::vec3 &scale)
+    {
+        mPositionX[index] = position.x;
+        mPositionY[index] = position.y;
+        mPositionZ[index] = position.z;
+        mRotationX[index] = rotation.x;
+        mRotationY[index] = rotation.y;
+        mRotationZ[index] = rotation.z;
+        mRotationW[index] = rotation.w;
+        mScaleX[index]    = scale.x;
+        mScaleY[index]    = scale.y;
+        mScaleZ[index]    = scale.z;
+    }
+
+    /**
+     * @brief 把[begin, end)的TRS组合成局部矩阵, out[i]对应第i个元素, 使用编译时可用的最宽的指令集
+     *
+     * @param begin
+     * @param end
+     * @param out
+     */
+    void Compose(size_t begin, size_t end, math::mat4 *out) const;
+
+    /**
+     * @brief 标量版本, 用于没有SIMD的平台, 处理不足一组的尾部和对比测试
+     */
+    void ComposeScalar(size_t begin, size_t end, math::mat4 *out) const;
+
+    /**
+     * @brief Compose使用的指令集, "AVX", "SSE" 或者 "Scalar"
+     */
+    static const char *GetSimdName();
+
+private:
+    // 每个分量的容量都按8个元素对齐, 这样每个数组的起始地址都是32字节对齐的
+    float *mData     = nullptr;
+    size_t mSize     = 0;
+    size_t mCapacity = 0;
+
+    float *mPositionX = nullptr;
+    float *mPositionY = nullptr;
+    float *mPositionZ = nullptr;
+    float *mRotationX = nullptr;
+    float *mRotationY = nullptr;
+    float *mRotationZ = nullptr;
+    float *mRotationW = nullptr;
+    float *mScaleX    = nullptr;
+    float *mScaleY    = nullptr;
+    float *mScaleZ    = nullptr;
+};
+} // namespace solis
@@ -0,0 +1,345 @@
+#include "core/math/triangle_bvh.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace solis {
+// SAH分桶的数量
+static const uint32_t TriangleBVHBins = 16;
+// 叶子中最多的三角形数量
+static const uint32_t TriangleBVHMaxLeafSize = 4;
+// 遍历栈的容量, 遍历时栈中最多有 深度 + 1 个节点
+static const uint32_t TriangleBVHStackSize = 64;
+// 超过这个深度改为按数量的中位数分割, 之后每层的三角形数量减半
+static const uint32_t TriangleBVHMedianDepth = 48;
+// 到达这个深度直接做成叶子, 保证遍历栈不会溢出
+static const uint32_t TriangleBVHMaxDepth = TriangleBVHStackSize - 1;
+// 遍历一个节点和测试一个三角形的相对代价
+static const float TriangleBVHTraversalCost = 1.0f;
+static const float TriangleBVHIntersectCost = 1.0f;
+
+void TriangleBVH::Clear()
+{
+    mNodes.clear();
+    mTriangles.clear();
+    mTriangleIds.clear();
+}
+
+AABB TriangleBVH::GetBounds() const
+{
+    return mNodes.empty() ? AABB() : AABB(mNodes[0].min, mNodes[0].max);
+}
+
+void TriangleBVH::Build(std::span<const math::vec3> positions, std::span<const uint32_t> indices)
+{
+    Clear();
+
+    auto count = static_cast<uint32_t>(indices.size() / 3);
+    if (count == 0)
+    {
+        return;
+    }
+
+    // 构建时使用每个三角形的包围盒和中心
+    vector<AABB>       boxes(count);
+    vector<math::vec3> centers(count);
+    vector<uint32_t>   order(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto &box = boxes[i];
+        box.Merge(positions[indices[i * 3]]);
+        box.Merge(positions[indices[i * 3 + 1]]);
+        box.Merge(positions[indices[i * 3 + 2]]);
+        centers[i] = box.Center();
+        order[i]   = i;
+    }
+
+    auto computeBounds = [&](Node &node) {
+        AABB bounds;
+        for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+        {
+            bounds.Merge(boxes[order[i]]);
+        }
+        node.min = bounds.min;
+        node.max = bounds.max;
+    };
+
+    mNodes.reserve(count * 2);
+    mNodes.push_back({math::vec3(0.0f), 0, math::vec3(0.0f), count});
+    computeBounds(mNodes[0]);
+
+    struct Bin
+    {
+        AABB     bounds;
+        uint32_t count = 0;
+    };
+
+    // (节点, 深度)
+    vector<std::pair<uint32_t, uint32_t>> pending{{0, 0}};
+    while (!pending.empty())
+    {
+        auto [nodeIndex, depth] = pending.back();
+        pending.pop_back();
+
+        auto first = mNodes[nodeIndex].leftOrFirst;
+        auto size  = mNodes[nodeIndex].count;
+        if (size <= TriangleBVHMaxLeafSize || depth >= TriangleBVHMaxDepth)
+        {
+            continue;
+        }
+
+        // 按中心的包围盒分桶
+        AABB centerBounds;
+        for (auto i = first; i < first + size; ++i)
+        {
+            centerBounds.Merge(centers[order[i]]);
+        }
+
+        uint32_t leftSize = 0;
+        if (depth >= TriangleBVHMedianDepth)
+        {
+            // 退化的几何(例如很长的三角形带)让SAH分出很深的链, 改为在最长的轴上按中位数分成两半
+            auto extent = centerBounds.max - centerBounds.min;
+            auto axis   = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+            leftSize    = size / 2;
+            std::nth_element(order.begin() + first, order.begin() + first + leftSize, order.begin() + first + size,
+                             [&](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+        }
+        else
+        {
+            int   bestAxis  = -1;
+            int   bestSplit = 0;
+            float bestCost  = FLT_MAX;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                auto lower  = centerBounds.min[axis];
+                auto extent = centerBounds.max[axis] - lower;
+                if (extent <= 0.0f)
+                {
+                    continue;
+                }
+
+                std::array<Bin, TriangleBVHBins> bins;
+                auto                             scale = TriangleBVHBins / extent;
+                for (auto i = first; i < first + size; ++i)
+                {
+                    auto bin = std::min(static_cast<uint32_t>((centers[order[i]][axis] - lower) * scale), TriangleBVHBins - 1);
+                    bins[bin].count++;
+                    bins[bin].bounds.Merge(boxes[order[i]]);
+                }
+
+                // 从两边累积, 得到每个分割位置两侧的面积和数量
+                std::array<float, TriangleBVHBins - 1>    leftArea, rightArea;
+                std::array<uint32_t, TriangleBVHBins - 1> leftCount, rightCount;
+                AABB                                      leftBox, rightBox;
+                uint32_t                                  leftSum = 0, rightSum = 0;
+                for (uint32_t i = 0; i < TriangleBVHBins - 1; ++i)
+                {
+                    leftSum += bins[i].count;
+                    leftCount[i] = leftSum;
+                    leftBox.Merge(bins[i].bounds);
+                    leftArea[i] = leftSum > 0 ? leftBox.SurfaceArea() : 0.0f;
+
+                    rightSum += bins[TriangleBVHBins - 1 - i].count;
+                    rightCount[TriangleBVHBins - 2 - i] = rightSum;
+                    rightBox.Merge(bins[TriangleBVHBins - 1 - i].bounds);
+                    rightArea[TriangleBVHBins - 2 - i] = rightSum > 0 ? rightBox.SurfaceArea() : 0.0f;
+                }
+
+                for (uint32_t i = 0; i < TriangleBVHBins - 1; ++i)
+                {
+                    auto cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+                    if (leftCount[i] > 0 && rightCount[i] > 0 && cost < bestCost)
+                    {
+                        bestCost  = cost;
+                        bestAxis  = axis;
+                        bestSplit = static_cast<int>(i);
+                    }
+                }
+            }
+
+            // 分割不比直接做成叶子便宜时停止, 所有中心重合时也只能做成叶子
+            auto &node     = mNodes[nodeIndex];
+            auto  nodeArea = AABB(node.min, node.max).SurfaceArea();
+            auto  leafCost = TriangleBVHIntersectCost * size;
+            auto  cost     = TriangleBVHTraversalCost + TriangleBVHIntersectCost * bestCost / std::max(nodeArea, FLT_MIN);
+            if (bestAxis < 0 || cost >= leafCost)
+            {
+                continue;
+            }
+
+            auto lower  = centerBounds.min[bestAxis];
+            auto scale  = TriangleBVHBins / (centerBounds.max[bestAxis] - lower);
+            auto middle = std::partition(order.begin() + first, order.begin() + first + size, [&](uint32_t triangle) {
+                auto bin = std::min(static_cast<uint32_t>((centers[triangle][bestAxis] - lower) * scale), TriangleBVHBins - 1);
+                return static_cast<int>(bin) <= bestSplit;
+            });
+            leftSize = static_cast<uint32_t>(middle - (order.begin() + first));
+        }
+
+        auto left = static_cast<uint32_t>(mNodes.size());
+        mNodes.push_back({math::vec3(0.0f), first, math::vec3(0.0f), leftSize});
+        mNodes.push_back({math::vec3(0.0f), first + leftSize, math::vec3(0.0f), size - leftSize});
+        computeBounds(mNodes[left]);
+        computeBounds(mNodes[left + 1]);
+
+        mNodes[nodeIndex].leftOrFirst = left;
+        mNodes[nodeIndex].count       = 0;
+
+        pending.push_back({left, depth + 1});
+        pending.push_back({left + 1, depth + 1});
+    }
+    mNodes.shrink_to_fit();
+
+    // 按叶子的顺序存储三角形
+    mTriangles.resize(count);
+    mTriangleIds = std::move(order);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto  id = mTriangleIds[i];
+        auto &v0 = positions[indices[id * 3]];
+        auto &v1 = positions[indices[id * 3 + 1]];
+        auto &v2 = positions[indices[id * 3 + 2]];
+
+        mTriangles[i] = {v0, v1 - v0, v2 - v0};
+    }
+}
+
+Ray TriangleBVH::ToLocal(const Ray &ray, const math::mat4 &world)
+{
+    auto inverse = math::inverse(world);
+
+    Ray local;
+    local.origin      = math::vec3(inverse * math::vec4(ray.origin, 1.0f));
+    local.direction   = math::vec3(inverse * math::vec4(ray.direction, 0.0f));
+    local.maxDistance = ray.maxDistance;
+    return local;
+}
+
+template <bool Any>
+bool TriangleBVH::Traverse(const Ray &ray, RayHit &hit) const
+{
+    if (mNodes.empty())
+    {
+        return false;
+    }
+
+    auto invDirection = 1.0f / ray.direction;
+    auto clipped      = ray;
+    bool found        = false;
+
+    auto nodeBox = [&](uint32_t index) {
+        auto &node = mNodes[index];
+        return AABB(node.min, node.max);
+    };
+
+    float tEnter = 0.0f;
+    if (!clipped.Intersects(nodeBox(0), invDirection, tEnter))
+    {
+        return false;
+    }
+
+    std::array<uint32_t, TriangleBVHStackSize> stack;
+    uint32_t                                   top = 0;
+    stack[top++]                                   = 0;
+    while (top > 0)
+    {
+        auto &node = mNodes[stack[--top]];
+        if (node.IsLeaf())
+        {
+            // Möller-Trumbore
+            for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+            {
+                auto &triangle    = mTriangles[i];
+                auto  p           = math::cross(clipped.direction, triangle.edge2);
+                auto  determinant = math::dot(triangle.edge1, p);
+                if (std::abs(determinant) < 1e-12f)
+                {
+                    continue;
+                }
+
+                auto invDeterminant = 1.0f / determinant;
+                auto s              = clipped.origin - triangle.v0;
+                auto u              = math::dot(s, p) * invDeterminant;
+                if (u < 0.0f || u > 1.0f)
+                {
+                    continue;
+                }
+
+                auto q = math::cross(s, triangle.edge1);
+                auto v = math::dot(clipped.direction, q) * invDeterminant;
+                if (v < 0.0f || u + v > 1.0f)
+                {
+                    continue;
+                }
+
+                auto t = math::dot(triangle.edge2, q) * invDeterminant;
+                if (t < 0.0f || t > clipped.maxDistance)
+                {
+                    continue;
+                }
+
+                found = true;
+                if constexpr (Any)
+                {
+                    return true;
+                }
+
+                clipped.maxDistance = t;
+                hit.distance        = t;
+                hit.triangle        = mTriangleIds[i];
+                hit.u               = u;
+                hit.v               = v;
+            }
+            continue;
+        }
+
+        // 近的子节点后入栈, 先被访问
+        float t1 = 0.0f, t2 = 0.0f;
+        bool  hit1 = clipped.Intersects(nodeBox(node.leftOrFirst), invDirection, t1);
+        bool  hit2 = clipped.Intersects(nodeBox(node.leftOrFirst + 1), invDirection, t2);
+        assert(top + 2 <= TriangleBVHStackSize && "TriangleBVH: traversal stack overflow");
+        if (hit1 && hit2)
+        {
+            stack[top++] = t1 < t2 ? node.leftOrFirst + 1 : node.leftOrFirst;
+            stack[top++] = t1 < t2 ? node.leftOrFirst : node.leftOrFirst + 1;
+        }
+        else if (hit1)
+        {
+            stack[top++] = node.leftOrFirst;
+        }
+        else if (hit2)
+        {
+            stack[top++] = node.leftOrFirst + 1;
+        }
+    }
+    return found;
+}
+
+bool TriangleBVH::Raycast(const Ray &ray, RayHit &hit) const
+{
+    RayHit result;
+    if (!Traverse<false>(ray, result))
+    {
+        return false;
+    }
+    hit = result;
+    return true;
+}
+
+bool TriangleBVH::RaycastAny(const Ray &ray) const
+{
+    RayHit result;
+    return Traverse<true>(ray, result);
+}
+
+bool TriangleBVH::Raycast(const Ray &ray, const math::mat4 &world, RayHit &hit) const
+{
+    return Raycast(ToLocal(ray, world), hit);
+}
+
+bool TriangleBVH::IntersectsSegment(const math::vec3 &from, const math::vec3 &to, const math::mat4 &world) const
+{
+    return RaycastAny(ToLocal(Ray{from, to - from, 1.0f}, world));
+}
+} // namespace solis
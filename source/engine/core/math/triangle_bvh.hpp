@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+#include "core/math/bounds.hpp"
+
+namespace solis {
+/**
+ * @brief 射线和三角形的交点
+ */
+struct RayHit
+{
+    // 射线参数, 交点是 ray.At(distance), 世界空间的查询中也是世界空间射线的参数
+    float distance = FLT_MAX;
+    // 原始索引中的三角形编号, 即索引下标 / 3
+    uint32_t triangle = 0xFFFFFFFF;
+    // 重心坐标, 交点 = (1 - u - v) * v0 + u * v1 + v * v2
+    float u = 0.0f;
+    float v = 0.0f;
+};
+
+/**
+ * @brief 单个网格的三角形BVH, 在加载时用分桶的表面积启发(SAH)构建, 之后只读, 可以在多个线程中同时查询
+ * 节点是32字节, 两个子节点相邻存储, 三角形按叶子的顺序重新排列
+ *
+ * 局部空间的查询直接使用网格的顶点坐标, 世界空间的查询把射线变换到局部空间
+ * 变换是线性的, 所以射线参数t在两个空间中是一样的, 不需要归一化方向
+ */
+class SOLIS_CORE_API TriangleBVH : public Object<TriangleBVH>
+{
+public:
+    OBJECT_NEW_DELETE(TriangleBVH)
+
+    // 作为Mesh的成员需要可以移动, 所以不声明析构函数
+    TriangleBVH() = default;
+
+    /**
+     * @brief 重新构建, 每3个索引一个三角形
+     */
+    void Build(std::span<const math::vec3> positions, std::span<const uint32_t> indices);
+
+    void Clear();
+
+    bool Empty() const
+    {
+        return mNodes.empty();
+    }
+
+    size_t GetNodeCount() const
+    {
+        return mNodes.size();
+    }
+
+    size_t GetTriangleCount() const
+    {
+        return mTriangles.size();
+    }
+
+    /**
+     * @brief 局部空间的包围盒
+     */
+    AABB GetBounds() const;
+
+    /**
+     * @brief 局部空间中[0, ray.maxDistance]内最近的交点, 正反面都会相交
+     *
+     * @return true 有交点, 结果写入hit
+     */
+    bool Raycast(const Ray &ray, RayHit &hit) const;
+
+    /**
+     * @brief 局部空间中[0, ray.maxDistance]内是否有任何交点, 找到第一个就返回, 用于视线检测
+     */
+    bool RaycastAny(const Ray &ray) const;
+
+    /**
+     * @brief 世界空间的射线和这个网格的一个实例求交
+     *
+     * @param ray 世界空间的射线
+     * @param world 实例的局部到世界的矩阵
+     * @param hit hit.distance是世界空间射线的参数
+     */
+    bool Raycast(const Ray &ray, const math::mat4 &world, RayHit &hit) const;
+
+    /**
+     * @brief 世界空间的线段[from, to]是否和实例相交
+     */
+    bool IntersectsSegment(const math::vec3 &from, const math::vec3 &to, const math::mat4 &world) const;
+
+private:
+    /**
+     * @brief 32字节的节点, count为0时是内部节点, leftOrFirst是左子节点, 右子节点是leftOrFirst + 1
+     * 否则是叶子, 包含从leftOrFirst开始的count个三角形
+     */
+    struct Node
+    {
+        math::vec3 min;
+        uint32_t   leftOrFirst;
+        math::vec3 max;
+        uint32_t   count;
+
+        bool IsLeaf() const
+        {
+            return count > 0;
+        }
+    };
+    static_assert(sizeof(Node) == 32, "TriangleBVH::Node must be 32 bytes");
+
+    /**
+     * @brief 按叶子顺序存储的三角形, 预先计算了两条边
+     */
+    struct Triangle
+    {
+        math::vec3 v0;
+        math::vec3 edge1;
+        math::vec3 edge2;
+    };
+
+    static Ray ToLocal(const Ray &ray, const math::mat4 &world);
+
+    template <bool Any>
+    bool Traverse(const Ray &ray, RayHit &hit) const;
+
+    vector<Node>     mNodes;
+    vector<Triangle> mTriangles;
+    // 重新排列之后的三角形在原始索引中的编号
+    vector<uint32_t> mTriangleIds;
+};
+} // namespace solis
@@ -110,6 +110,10 @@ void Engine::Step()
     UpdateStage(Module::Stage::Always);
     UpdateStage(Module::Stage::Pre);
     UpdateStage(Module::Stage::Normal);
+
+    // 回放这一帧记录的结构性修改
+    World::Get()->SyncPoint();
+
     UpdateStage(Module::Stage::Post);
     UpdateStage(Module::Stage::Render);
 }
@@ -2,6 +2,10 @@
 
 namespace solis {
 namespace components {
+Camera::Camera()
+{
+}
+
 void Camera::OnAdd(GameObject *gameObject)
 {
 }
@@ -10,5 +14,20 @@ void Camera::OnRemove(GameObject *gameObject)
 {
 }
 
+math::mat4 Camera::GetProjectionMatrix() const
+{
+    bool rightHanded = mProjection == Projection::RightHanded;
+    if (mType == Type::Orthographic)
+    {
+        auto height = mOrthographicSize;
+        auto width  = height * mAspect;
+        return rightHanded ? math::orthoRH(-width, width, -height, height, mNear, mFar)
+                           : math::orthoLH(-width, width, -height, height, mNear, mFar);
+    }
+
+    return rightHanded ? math::perspectiveRH(math::radians(mFov), mAspect, mNear, mFar)
+                       : math::perspectiveLH(math::radians(mFov), mAspect, mNear, mFar);
+}
+
 }
 } // namespace solis::components
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "core/base/object.hpp"
 #include "core/base/using.hpp"
 
+#include "core/math/mat.hpp"
 #include "core/data/component.hpp"
 
 namespace solis {
@@ -51,6 +52,14 @@ public:
         mAspect = aspect;
     }
 
+    /**
+     * @brief 正交投影时视口高度的一半
+     */
+    void SetOrthographicSize(float size)
+    {
+        mOrthographicSize = size;
+    }
+
     void SetType(Type type)
     {
         mType = type;
@@ -81,6 +90,11 @@ public:
         return mAspect;
     }
 
+    float GetOrthographicSize() const
+    {
+        return mOrthographicSize;
+    }
+
     Type GetType() const
     {
         return mType;
@@ -91,12 +105,19 @@ public:
         return mProjection;
     }
 
+    /**
+     * @brief 由类型, 手系, fov(角度), 宽高比和远近平面计算的投影矩阵
+     */
+    math::mat4 GetProjectionMatrix() const;
+
 private:
     float mNear   = 0.1f;
     float mFar    = 1000.0f;
     float mFov    = 45.0f;
     float mAspect = 1.0f;
 
+    float mOrthographicSize = 5.0f;
+
     Type       mType       = Type::Perspective;
     Projection mProjection = Projection::RightHanded;
 };
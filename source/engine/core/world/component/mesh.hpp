@@ -5,11 +5,9 @@
 #include "core/base/using.hpp"
 
 #include "core/data/component.hpp"
+#include "core/data/mesh.hpp"
 
 namespace solis {
-
-class Mesh;
-
 namespace components {
 class SOLIS_CORE_API Mesh : public Component<Mesh>
 {
@@ -29,6 +27,24 @@ public:
         mMeshes = meshes;
     }
 
+    const vector<std::shared_ptr<solis::Mesh>> &GetMeshes() const
+    {
+        return mMeshes;
+    }
+
+    /**
+     * @brief 所有mesh的局部包围盒的并集, 用于插入SpatialSystem
+     */
+    AABB GetLocalBounds() const
+    {
+        AABB bounds;
+        for (auto &mesh : mMeshes)
+        {
+            bounds.Merge(mesh->GetBounds());
+        }
+        return bounds;
+    }
+
 private:
     vector<std::shared_ptr<solis::Mesh>> mMeshes;
 };
@@ -13,17 +13,20 @@
 
 namespace solis {
 // forward declare
+class TransformSystem;
 namespace components {
 class Transform;
 }
 
 struct TransformExpiredEvent : public Event
 {
-    TransformExpiredEvent(const components::Transform *transform) :
-        transform(transform)
+    TransformExpiredEvent(const components::Transform *transform, EntityID id) :
+        transform(transform), id(id)
     {
     }
+    // 处理函数返回之后transform就会被销毁, 只应该用来比较地址
     const components::Transform *transform;
+    EntityID                     id;
 };
 
 struct TransformChangedEvent : public Event
@@ -44,7 +47,8 @@ public:
 
     virtual void OnDestroy() override
     {
-        OnExpired.PostInvoke({this});
+        // 必须立即分发, 组件会在这之后被析构, 延迟的事件会随着OnExpired一起被销毁
+        OnExpired.Invoke({this, mEntityID});
 
         OnExpired.Reset();
     }
@@ -68,28 +72,53 @@ public:
     {
         mPosition = position;
 
-        OnChanged.PostInvoke({this});
+        Changed();
     }
 
     void SetRotation(const math::vec3 &rotation)
     {
         mRotation = rotation;
 
-        OnChanged.PostInvoke({this});
+        Changed();
     }
 
     void SetScale(const math::vec3 &scale)
     {
         mScale = scale;
 
-        OnChanged.PostInvoke({this});
+        Changed();
+    }
+
+    /**
+     * @brief 由位置, 欧拉角(弧度)和缩放组成的局部矩阵
+     */
+    math::mat4 GetLocalMatrix() const
+    {
+        auto matrix = math::translate(math::mat4(1.0f), mPosition) * math::mat4_cast(math::quat(mRotation));
+        return math::scale(matrix, mScale);
+    }
+
+    /**
+     * @brief 局部到世界的矩阵, 由TransformSystem::Update沿着层级计算
+     */
+    const math::mat4 &GetWorldMatrix() const
+    {
+        return mWorldMatrix;
+    }
+
+    /**
+     * @brief 局部变换在上一次TransformSystem::Update之后被修改过
+     */
+    bool IsDirty() const
+    {
+        return mDirty;
     }
 
     void LookAt(const math::vec3 &target, const math::vec3 &up = math::vec3(0.0f, 1.0f, 0.0f))
     {
         mViewMatrix = math::lookAt(mPosition, target, up);
 
-        OnChanged.PostInvoke({this});
+        Changed();
     }
 
     EventProperty<TransformExpiredEvent> OnExpired;
@@ -97,11 +126,65 @@ public:
     EventProperty<TransformChangedEvent> OnChanged;
 
 private:
+    friend class ::solis::TransformSystem;
+    friend struct SnapshotSerializer<Transform>;
+
+    void Changed()
+    {
+        mDirty = true;
+
+        MarkChanged();
+        if (OnChanged.HasCallbacks())
+        {
+            OnChanged.PostInvoke({this});
+        }
+    }
+
     math::vec3 mPosition{0.0f, 0.0f, 0.0f};
     math::vec3 mRotation{0.0f, 0.0f, 0.0f};
     math::vec3 mScale{1.0f, 1.0f, 1.0f};
 
     math::mat4 mViewMatrix;
+    math::mat4 mWorldMatrix{1.0f};
+
+    // 新的Transform也需要计算一次世界矩阵
+    bool mDirty = true;
 };
 } // namespace components
+
+/**
+ * @brief Transform的存档只包含变换数据和EntityID, 事件的订阅不会被保存
+ */
+template <>
+struct SnapshotSerializer<components::Transform>
+{
+    static constexpr bool Enabled = true;
+
+    static void Write(SnapshotWriter &writer, const components::Transform &value)
+    {
+        writer.Write(value.mEntityID);
+        writer.Write(value.mPosition);
+        writer.Write(value.mRotation);
+        writer.Write(value.mScale);
+        writer.Write(value.mViewMatrix);
+    }
+
+    static bool Read(SnapshotReader &reader, void *slot)
+    {
+        components::Transform value;
+        if (!reader.Read(value.mEntityID) || !reader.Read(value.mPosition) || !reader.Read(value.mRotation) ||
+            !reader.Read(value.mScale) || !reader.Read(value.mViewMatrix))
+        {
+            return false;
+        }
+
+        auto transform         = ::new (slot) components::Transform();
+        transform->mEntityID   = value.mEntityID;
+        transform->mPosition   = value.mPosition;
+        transform->mRotation   = value.mRotation;
+        transform->mScale      = value.mScale;
+        transform->mViewMatrix = value.mViewMatrix;
+        return true;
+    }
+};
 } // namespace solis
\ No newline at end of file
@@ -0,0 +1,19 @@
+#include "core/world/prefab.hpp"
+
+namespace solis {
+vector<GameObject *> Prefab::Instantiate(size_t count) const
+{
+    vector<GameObject *> objects(count);
+    for (auto &object : objects)
+    {
+        object = new GameObject();
+    }
+
+    // 按组件类型批量处理, 每种组件的池操作是连续的
+    for (auto &entry : mEntries)
+    {
+        entry(std::span<GameObject *const>(objects.data(), objects.size()));
+    }
+    return objects;
+}
+} // namespace solis
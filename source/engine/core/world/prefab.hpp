@@ -0,0 +1,102 @@
+#pragma once
+
+#include <functional>
+#include <span>
+#include <type_traits>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+#include "core/data/component.hpp"
+#include "core/data/game_object.hpp"
+#include "core/world/component/transform.hpp"
+#include "core/world/system/transform_system.hpp"
+
+namespace solis {
+/**
+ * @brief 由一组组件组成的模板, 用于一次性地实例化大量相同的GameObject
+ * 每种组件只预留一次组件池, Transform只批量注册一次到TransformSystem
+ *
+ * Prefab prefab;
+ * prefab.Add<components::Transform>().Add<components::Mesh>([&](components::Mesh &mesh) { mesh.SetMeshs(meshes); });
+ * prefab.Add(health); // 从原型health复制
+ * auto objects = prefab.Instantiate(1000);
+ */
+class SOLIS_CORE_API Prefab : public Object<Prefab>
+{
+public:
+    OBJECT_NEW_DELETE(Prefab)
+
+    Prefab()          = default;
+    virtual ~Prefab() = default;
+
+    /**
+     * @brief 添加一种使用内置组件池的组件
+     *
+     * @tparam T
+     * @param init 每个实例的组件在添加到GameObject之前调用, void(T &)
+     * @return Prefab&
+     */
+    template <typename T>
+    std::enable_if_t<std::is_base_of_v<Component<T>, T>, Prefab &>
+    Add(std::function<void(T &)> &&init = nullptr)
+    {
+        mEntries.push_back([init = std::move(init)](std::span<GameObject *const> objects) {
+            AddComponents<T>(objects, nullptr, init);
+        });
+        return *this;
+    }
+
+    /**
+     * @brief 添加一种从原型复制的组件, 可平凡复制的组件直接memcpy, 不调用构造函数
+     *
+     * @tparam T
+     * @param prototype 保存一份副本, 所有实例都从它复制
+     * @param init 只用于每个实例不同的部分, 在复制之后调用, void(T &)
+     * @return Prefab&
+     */
+    template <typename T>
+    std::enable_if_t<std::is_base_of_v<Component<T>, T> && std::is_copy_constructible_v<T>, Prefab &>
+    Add(const T &prototype, std::type_identity_t<std::function<void(T &)>> &&init = nullptr)
+    {
+        mEntries.push_back([prototype, init = std::move(init)](std::span<GameObject *const> objects) {
+            AddComponents<T>(objects, &prototype, init);
+        });
+        return *this;
+    }
+
+    /**
+     * @brief 实例化count个GameObject, 和MainWorld一样, GameObject需要外部释放
+     *
+     * @param count
+     * @return vector<GameObject *>
+     */
+    vector<GameObject *> Instantiate(size_t count) const;
+
+private:
+    template <typename T>
+    static void AddComponents(std::span<GameObject *const> objects, const T *prototype, const std::function<void(T &)> &init)
+    {
+        vector<T *> components(objects.size());
+        T::Get(components.size(), components.data(), prototype);
+
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            if (init)
+            {
+                init(*components[i]);
+            }
+            objects[i]->AddComponent(components[i]);
+        }
+
+        if constexpr (std::is_same_v<T, components::Transform>)
+        {
+            TransformSystem::Get()->Watch(std::span<components::Transform *const>(components.data(), components.size()));
+        }
+    }
+
+    // 每种组件一个批量实例化的函数
+    vector<std::function<void(std::span<GameObject *const>)>> mEntries;
+};
+} // namespace solis
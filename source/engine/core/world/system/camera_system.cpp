@@ -0,0 +1,16 @@
+#include "core/world/system/camera_system.hpp"
+
+namespace solis {
+void CameraSystem::Update()
+{
+    if (!HasActiveCamera())
+    {
+        return;
+    }
+
+    mView           = math::inverse(mTransform->GetWorldMatrix());
+    mProjection     = mCamera->GetProjectionMatrix();
+    mViewProjection = mProjection * mView;
+    mFrustum        = Frustum::FromMatrix(mViewProjection);
+}
+} // namespace solis
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+#include "core/data/system.hpp"
+#include "core/math/bounds.hpp"
+#include "core/world/component/camera.hpp"
+#include "core/world/component/transform.hpp"
+
+namespace solis {
+/**
+ * @brief 管理当前使用的相机, 每帧在TransformSystem之后计算视图矩阵, 投影矩阵和视锥体
+ */
+class SOLIS_CORE_API CameraSystem : public System<CameraSystem>, public Object<CameraSystem>
+{
+public:
+    OBJECT_NEW_DELETE(CameraSystem)
+
+    virtual ~CameraSystem() = default;
+
+    virtual void Update() override;
+
+    /**
+     * @brief 设置当前的相机, 相机的位置和朝向来自transform的世界矩阵
+     * 相机或者transform被销毁之前需要调用SetActiveCamera(nullptr, nullptr)
+     *
+     * @param camera
+     * @param transform
+     */
+    void SetActiveCamera(components::Camera *camera, components::Transform *transform)
+    {
+        mCamera    = camera;
+        mTransform = transform;
+    }
+
+    bool HasActiveCamera() const
+    {
+        return mCamera != nullptr && mTransform != nullptr;
+    }
+
+    components::Camera *GetActiveCamera() const
+    {
+        return mCamera;
+    }
+
+    const math::mat4 &GetViewMatrix() const
+    {
+        return mView;
+    }
+
+    const math::mat4 &GetProjectionMatrix() const
+    {
+        return mProjection;
+    }
+
+    const math::mat4 &GetViewProjectionMatrix() const
+    {
+        return mViewProjection;
+    }
+
+    /**
+     * @brief 世界空间的视锥体, 没有相机时所有平面都是0
+     */
+    const Frustum &GetFrustum() const
+    {
+        return mFrustum;
+    }
+
+    /**
+     * @brief 相机在世界空间的位置
+     */
+    math::vec3 GetPosition() const
+    {
+        return math::vec3(mTransform != nullptr ? mTransform->GetWorldMatrix()[3] : math::vec4(0.0f));
+    }
+
+private:
+    components::Camera    *mCamera    = nullptr;
+    components::Transform *mTransform = nullptr;
+
+    math::mat4 mView{1.0f};
+    math::mat4 mProjection{1.0f};
+    math::mat4 mViewProjection{1.0f};
+    Frustum    mFrustum{};
+};
+} // namespace solis
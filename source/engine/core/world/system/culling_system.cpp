@@ -0,0 +1,37 @@
+#include "core/world/system/culling_system.hpp"
+
+#include "core/world/system/camera_system.hpp"
+#include "core/world/system/spatial_system.hpp"
+
+namespace solis {
+void CullingSystem::Update()
+{
+    mVisible.clear();
+    mStats = {};
+
+    auto cameraSystem = CameraSystem::Get();
+    if (!cameraSystem->HasActiveCamera())
+    {
+        return;
+    }
+
+    // 放大的包围盒完全在视锥体内时, 准确的包围盒也一定在视锥体内
+    auto  spatialSystem = SpatialSystem::Get();
+    auto &frustum       = cameraSystem->GetFrustum();
+    mCuller.Clear();
+    spatialSystem->GetTree().QueryFrustum(frustum, [&](uint32_t proxy, bool inside) {
+        if (inside)
+        {
+            mVisible.push_back(proxy);
+        }
+        else
+        {
+            mCuller.AddBox(spatialSystem->GetWorldBounds(proxy), proxy);
+        }
+    });
+
+    mStats.tested = static_cast<uint32_t>(mCuller.Count());
+    mCuller.Cull(frustum, mVisible);
+    mStats.visible = static_cast<uint32_t>(mVisible.size());
+}
+} // namespace solis
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+#include "core/data/system.hpp"
+#include "core/math/frustum_culler.hpp"
+
+namespace solis {
+/**
+ * @brief 视锥体剔除, 在SpatialSystem之后用当前相机的视锥体遍历空间索引
+ * 完全在视锥体内的子树直接可见, 和视锥体相交的叶子再用准确的世界包围盒批量测试
+ * 结果是SpatialSystem的代理编号, 渲染提取通过SpatialSystem::GetTransform/GetUserData访问物体
+ */
+class SOLIS_CORE_API CullingSystem : public System<CullingSystem>, public Object<CullingSystem>
+{
+public:
+    OBJECT_NEW_DELETE(CullingSystem)
+
+    struct Stats
+    {
+        // 用准确的包围盒测试过的物体数量, 在完全可见的子树中的物体不需要测试
+        uint32_t tested = 0;
+        // 可见的物体数量
+        uint32_t visible = 0;
+    };
+
+    virtual ~CullingSystem() = default;
+
+    virtual void Update() override;
+
+    /**
+     * @brief 上一次Update中可见的代理, 没有相机时是空的
+     *
+     * @return const vector<uint32_t>&
+     */
+    const vector<uint32_t> &GetVisible() const
+    {
+        return mVisible;
+    }
+
+    const Stats &GetStats() const
+    {
+        return mStats;
+    }
+
+private:
+    FrustumCuller    mCuller;
+    vector<uint32_t> mVisible;
+    Stats            mStats;
+};
+} // namespace solis
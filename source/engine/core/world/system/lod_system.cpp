@@ -0,0 +1,81 @@
+#include "core/world/system/lod_system.hpp"
+
+#include <cmath>
+
+#include "core/world/system/camera_system.hpp"
+#include "core/world/system/occlusion_system.hpp"
+#include "core/world/system/spatial_system.hpp"
+
+namespace solis {
+/**
+ * @brief 满足 screenSize >= MeshLodScreenSizes[level] * scale 的最精细的级别
+ */
+static uint32_t FindLevel(float screenSize, float scale)
+{
+    for (uint32_t level = 0; level + 1 < MeshMaxLods; ++level)
+    {
+        if (screenSize >= MeshLodScreenSizes[level] * scale)
+        {
+            return level;
+        }
+    }
+    return MeshMaxLods - 1;
+}
+
+uint32_t LodSystem::SelectLevel(float screenSize, uint32_t current)
+{
+    // 变精细需要越过阈值的(1 + h)倍, 变粗糙需要低于阈值的(1 - h)倍, 中间保持不变
+    auto coarsest = FindLevel(screenSize, 1.0f + LodHysteresis);
+    auto finest   = FindLevel(screenSize, 1.0f - LodHysteresis);
+    return std::clamp(current, finest, coarsest);
+}
+
+void LodSystem::Update()
+{
+    mLevelCounts.fill(0);
+
+    auto cameraSystem = CameraSystem::Get();
+    if (!cameraSystem->HasActiveCamera())
+    {
+        return;
+    }
+
+    // 透视投影时屏幕大小 = 半径 / (距离 * tan(fov / 2)), 正交投影时 = 半径 / 正交大小
+    auto camera       = cameraSystem->GetActiveCamera();
+    auto position     = cameraSystem->GetPosition();
+    bool orthographic = camera->GetType() == components::Camera::Type::Orthographic;
+    auto scale        = orthographic ? 1.0f / camera->GetOrthographicSize() : 1.0f / std::tan(math::radians(camera->GetFov()) * 0.5f);
+    scale *= std::exp2(-mBias);
+
+    auto spatialSystem = SpatialSystem::Get();
+    for (auto proxy : OcclusionSystem::Get()->GetVisible())
+    {
+        if (proxy >= mLevels.size())
+        {
+            mLevels.resize(std::max<size_t>(proxy + 1, mLevels.size() * 2), 0);
+        }
+
+        auto &bounds = spatialSystem->GetWorldBounds(proxy);
+        auto  radius = math::length(bounds.Extent());
+
+        float screenSize = FLT_MAX;
+        if (orthographic)
+        {
+            screenSize = radius * scale;
+        }
+        else
+        {
+            // 相机在包围球内时总是用最精细的一级
+            auto distance = math::length(bounds.Center() - position);
+            if (distance > radius)
+            {
+                screenSize = radius * scale / distance;
+            }
+        }
+
+        auto level     = SelectLevel(screenSize, mLevels[proxy]);
+        mLevels[proxy] = static_cast<uint8_t>(level);
+        mLevelCounts[level]++;
+    }
+}
+} // namespace solis
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+#include "core/base/const.hpp"
+
+#include "core/data/system.hpp"
+
+namespace solis {
+/**
+ * @brief 按屏幕大小选择LOD, 在OcclusionSystem之后只处理可见的物体
+ * 屏幕大小是世界包围盒的包围球投影到屏幕上的高度占比, 和MeshLodScreenSizes比较
+ * 每个物体记住上一帧的级别, 屏幕大小越过阈值LodHysteresis的比例才会切换
+ */
+class SOLIS_CORE_API LodSystem : public System<LodSystem>, public Object<LodSystem>
+{
+public:
+    OBJECT_NEW_DELETE(LodSystem)
+
+    virtual ~LodSystem() = default;
+
+    virtual void Update() override;
+
+    /**
+     * @brief 全局的LOD偏移, 正数选择更粗糙的LOD, 每增加1屏幕大小按一半计算
+     * 可以根据帧时间调整, 超出预算时增大
+     *
+     * @param bias
+     */
+    void SetBias(float bias)
+    {
+        mBias = bias;
+    }
+
+    float GetBias() const
+    {
+        return mBias;
+    }
+
+    /**
+     * @brief 代理在上一次Update中选择的LOD级别, 不同的mesh级数不同, 绘制时由Mesh::GetLod限制
+     *
+     * @param proxy SpatialSystem的代理
+     * @return uint32_t 没有被选择过的代理返回0
+     */
+    uint32_t GetLevel(uint32_t proxy) const
+    {
+        return proxy < mLevels.size() ? mLevels[proxy] : 0;
+    }
+
+    /**
+     * @brief 上一次Update中每一级LOD的物体数量
+     */
+    const std::array<uint32_t, MeshMaxLods> &GetLevelCounts() const
+    {
+        return mLevelCounts;
+    }
+
+    /**
+     * @brief 按屏幕大小选择LOD, 考虑滞后
+     *
+     * @param screenSize 已经应用了偏移的屏幕大小
+     * @param current 当前的级别
+     * @return uint32_t
+     */
+    static uint32_t SelectLevel(float screenSize, uint32_t current);
+
+private:
+    float mBias = 0.0f;
+
+    // 按代理编号存储, 代理被删除之后再被复用时会继承上一个物体的级别, 只影响一次滞后
+    vector<uint8_t>                   mLevels;
+    std::array<uint32_t, MeshMaxLods> mLevelCounts{};
+};
+} // namespace solis
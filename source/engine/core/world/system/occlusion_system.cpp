@@ -0,0 +1,90 @@
+#include "core/world/system/occlusion_system.hpp"
+
+#include "core/base/job_system.hpp"
+#include "core/data/mesh.hpp"
+#include "core/world/system/camera_system.hpp"
+#include "core/world/system/culling_system.hpp"
+#include "core/world/system/spatial_system.hpp"
+
+namespace solis {
+// 并行测试包围盒时每个任务块的物体数量
+static const size_t OcclusionTestGrain = 256;
+
+void OcclusionSystem::Update()
+{
+    auto &candidates = CullingSystem::Get()->GetVisible();
+
+    mStats = {};
+    mVisible.clear();
+
+    auto cameraSystem = CameraSystem::Get();
+    if (mOccluders.empty() || !cameraSystem->HasActiveCamera())
+    {
+        mVisible.assign(candidates.begin(), candidates.end());
+        return;
+    }
+
+    mBuffer.Begin(cameraSystem->GetViewProjectionMatrix());
+    for (auto &occluder : mOccluders)
+    {
+        mBuffer.AddOccluder(occluder.mesh->GetPositions(), occluder.mesh->GetIndices(), occluder.transform->GetWorldMatrix());
+    }
+    mBuffer.Rasterize();
+    mStats.triangles = static_cast<uint32_t>(mBuffer.GetTriangleCount());
+
+    // 每个物体只写自己的标记, 最后按原来的顺序压缩
+    auto spatialSystem = SpatialSystem::Get();
+    mVisibleFlags.resize(candidates.size());
+    JobSystem::Get()->ParallelFor(candidates.size(), OcclusionTestGrain, [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            mVisibleFlags[i] = mBuffer.IsVisible(spatialSystem->GetWorldBounds(candidates[i])) ? 1 : 0;
+        }
+    });
+
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (mVisibleFlags[i] != 0)
+        {
+            mVisible.push_back(candidates[i]);
+        }
+    }
+
+    mStats.tested   = static_cast<uint32_t>(candidates.size());
+    mStats.occluded = static_cast<uint32_t>(candidates.size() - mVisible.size());
+}
+
+void OcclusionSystem::AddOccluder(components::Transform &transform, std::shared_ptr<Mesh> mesh)
+{
+    assert(transform.mEntityID.IsValid() && "OcclusionSystem::AddOccluder: transform must be allocated from the pool");
+
+    auto occluder = mTracker.Find(transform);
+    if (occluder != TransformTracker::InvalidIndex)
+    {
+        mOccluders[occluder].mesh = std::move(mesh);
+        return;
+    }
+
+    mTracker.Add(transform, static_cast<uint32_t>(mOccluders.size()));
+    mOccluders.push_back({&transform, std::move(mesh)});
+}
+
+void OcclusionSystem::RemoveOccluder(const components::Transform &transform)
+{
+    auto occluder = mTracker.Remove(transform);
+    if (occluder != TransformTracker::InvalidIndex)
+    {
+        RemoveOccluderAt(occluder);
+    }
+}
+
+void OcclusionSystem::RemoveOccluderAt(uint32_t occluder)
+{
+    if (occluder + 1 != mOccluders.size())
+    {
+        mOccluders[occluder] = std::move(mOccluders.back());
+        mTracker.SetIndex(*mOccluders[occluder].transform, occluder);
+    }
+    mOccluders.pop_back();
+}
+} // namespace solis
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <memory>
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+#include "core/data/system.hpp"
+#include "core/math/occlusion_buffer.hpp"
+#include "core/world/component/transform.hpp"
+#include "core/world/system/transform_tracker.hpp"
+
+namespace solis {
+class Mesh;
+
+/**
+ * @brief CPU软件遮挡剔除, 在CullingSystem之后, 提交绘制之前
+ * 把指定的遮挡物光栅化到低分辨率的深度缓冲中, 然后用视锥体剔除之后的物体的包围盒测试
+ * 没有遮挡物或者没有相机时, 结果和CullingSystem的一样
+ */
+class SOLIS_CORE_API OcclusionSystem : public System<OcclusionSystem>, public EventHandler, public Object<OcclusionSystem>
+{
+public:
+    OBJECT_NEW_DELETE(OcclusionSystem)
+
+    struct Stats
+    {
+        // 用深度缓冲测试过的物体数量
+        uint32_t tested = 0;
+        // 被遮挡的物体数量
+        uint32_t occluded = 0;
+        // 光栅化的遮挡物三角形数量
+        uint32_t triangles = 0;
+    };
+
+    virtual ~OcclusionSystem() = default;
+
+    virtual void Update() override;
+
+    /**
+     * @brief 指定一个遮挡物, 应该是大而简单的网格, 例如墙和地面
+     * transform被释放时遮挡物会被自动移除
+     *
+     * @param transform 必须是从组件池中分配的
+     * @param mesh 使用mesh在CPU端的顶点位置和索引
+     */
+    void AddOccluder(components::Transform &transform, std::shared_ptr<Mesh> mesh);
+
+    void RemoveOccluder(const components::Transform &transform);
+
+    size_t GetOccluderCount() const
+    {
+        return mOccluders.size();
+    }
+
+    /**
+     * @brief 上一次Update中可见的SpatialSystem代理, 是CullingSystem::GetVisible的子集, 顺序不变
+     *
+     * @return const vector<uint32_t>&
+     */
+    const vector<uint32_t> &GetVisible() const
+    {
+        return mVisible;
+    }
+
+    const Stats &GetStats() const
+    {
+        return mStats;
+    }
+
+    const OcclusionBuffer &GetBuffer() const
+    {
+        return mBuffer;
+    }
+
+private:
+    struct Occluder
+    {
+        components::Transform *transform = nullptr;
+        std::shared_ptr<Mesh>  mesh;
+    };
+
+    /**
+     * @brief 和最后一个遮挡物交换之后删除, 遮挡物的顺序不影响深度缓冲
+     */
+    void RemoveOccluderAt(uint32_t occluder);
+
+    OcclusionBuffer  mBuffer;
+    vector<Occluder> mOccluders;
+    // transform -> 遮挡物下标, transform被销毁时删除遮挡物
+    TransformTracker mTracker{[this](uint32_t occluder) { RemoveOccluderAt(occluder); }};
+
+    vector<uint32_t> mVisible;
+    vector<uint8_t>  mVisibleFlags;
+    Stats            mStats;
+};
+} // namespace solis
@@ -0,0 +1,96 @@
+#include "core/world/system/spatial_hash_system.hpp"
+
+#include "core/base/job_system.hpp"
+
+namespace solis {
+static_assert(SpatialHashSystem::InvalidEntry == TransformTracker::InvalidIndex);
+
+// 并行读取位置时每个任务块的物体数量
+static const size_t SpatialHashGatherGrain = 1024;
+
+void SpatialHashSystem::Update()
+{
+    // 网格马上要被重建, 不再引用上一次Update之后被移除的条目
+    mFreeEntries.insert(mFreeEntries.end(), mPendingFreeEntries.begin(), mPendingFreeEntries.end());
+    mPendingFreeEntries.clear();
+
+    mGridEntries.clear();
+    for (uint32_t entry = 0; entry < mEntries.size(); ++entry)
+    {
+        if (mEntries[entry].transform != nullptr)
+        {
+            mGridEntries.push_back(entry);
+        }
+    }
+
+    // 世界矩阵已经由TransformSystem计算好了, 这里只读取平移部分
+    mGridPositions.resize(mGridEntries.size());
+    JobSystem::Get()->ParallelFor(mGridEntries.size(), SpatialHashGatherGrain, [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto &data        = mEntries[mGridEntries[i]];
+            data.position     = math::vec3(data.transform->GetWorldMatrix()[3]);
+            mGridPositions[i] = data.position;
+        }
+    });
+
+    mGrid.Build(mGridPositions);
+}
+
+uint32_t SpatialHashSystem::Insert(components::Transform &transform, void *userData)
+{
+    assert(transform.mEntityID.IsValid() && "SpatialHashSystem::Insert: transform must be allocated from the pool");
+
+    auto entry = FindEntry(transform);
+    if (entry != InvalidEntry)
+    {
+        mEntries[entry].userData = userData;
+        return entry;
+    }
+
+    if (mFreeEntries.empty())
+    {
+        entry = static_cast<uint32_t>(mEntries.size());
+        mEntries.emplace_back();
+    }
+    else
+    {
+        entry = mFreeEntries.back();
+        mFreeEntries.pop_back();
+    }
+    mEntries[entry] = {&transform, userData, math::vec3(transform.GetWorldMatrix()[3])};
+    mTracker.Add(transform, entry);
+    return entry;
+}
+
+void SpatialHashSystem::Remove(const components::Transform &transform)
+{
+    auto entry = mTracker.Remove(transform);
+    if (entry != InvalidEntry)
+    {
+        RemoveEntry(entry);
+    }
+}
+
+uint32_t SpatialHashSystem::FindEntry(const components::Transform &transform) const
+{
+    return mTracker.Find(transform);
+}
+
+void SpatialHashSystem::Reset()
+{
+    mTracker.Clear();
+    mGrid.Clear();
+    mEntries.clear();
+    mFreeEntries.clear();
+    mPendingFreeEntries.clear();
+    mGridEntries.clear();
+    mGridPositions.clear();
+}
+
+void SpatialHashSystem::RemoveEntry(uint32_t entry)
+{
+    mEntries[entry] = Entry();
+    mPendingFreeEntries.push_back(entry);
+}
+} // namespace solis
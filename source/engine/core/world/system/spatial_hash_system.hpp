@@ -0,0 +1,159 @@
+#pragma once
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+#include "core/data/system.hpp"
+#include "core/math/spatial_hash_grid.hpp"
+#include "core/world/component/transform.hpp"
+#include "core/world/system/transform_tracker.hpp"
+
+namespace solis {
+/**
+ * @brief 按世界坐标的位置索引大量快速移动的物体, 用于附近的单位, 触发区域和AI感知等查询
+ * 在TransformSystem::Update之后, 每帧并行读取所有物体的位置, 然后完全重建网格
+ * 和SpatialSystem不同, 物体被当作点, 不需要包围盒, 也没有维护树的开销
+ *
+ * 查询使用上一次Update时的位置, Update之后插入的物体要到下一次Update才能被查询到
+ */
+class SOLIS_CORE_API SpatialHashSystem : public System<SpatialHashSystem>, public EventHandler, public Object<SpatialHashSystem>
+{
+public:
+    OBJECT_NEW_DELETE(SpatialHashSystem)
+
+    inline static const uint32_t InvalidEntry = 0xFFFFFFFF;
+
+    virtual ~SpatialHashSystem() = default;
+
+    virtual void Update() override;
+
+    /**
+     * @brief 加入一个物体, transform被释放时会被自动移除, O(1)
+     * 重复加入时只更新userData
+     *
+     * @param transform 必须是从组件池中分配的
+     * @param userData 查询时可以通过GetUserData取回
+     * @return uint32_t 条目编号, 在Remove之前不会改变
+     */
+    uint32_t Insert(components::Transform &transform, void *userData = nullptr);
+
+    /**
+     * @brief 移除transform, 立即不再出现在查询结果中, O(1)
+     */
+    void Remove(const components::Transform &transform);
+
+    /**
+     * @brief transform的条目编号, 没有时返回InvalidEntry, O(1)
+     */
+    uint32_t FindEntry(const components::Transform &transform) const;
+
+    components::Transform *GetTransform(uint32_t entry) const
+    {
+        return mEntries[entry].transform;
+    }
+
+    void *GetUserData(uint32_t entry) const
+    {
+        return mEntries[entry].userData;
+    }
+
+    /**
+     * @brief 上一次Update时的世界坐标
+     */
+    const math::vec3 &GetPosition(uint32_t entry) const
+    {
+        return mEntries[entry].position;
+    }
+
+    size_t Count() const
+    {
+        return mEntries.size() - mFreeEntries.size() - mPendingFreeEntries.size();
+    }
+
+    /**
+     * @brief 修改格子边长, 下一次Update时生效
+     */
+    void SetCellSize(float cellSize)
+    {
+        mGrid.SetCellSize(cellSize);
+    }
+
+    float GetCellSize() const
+    {
+        return mGrid.GetCellSize();
+    }
+
+    /**
+     * @brief 取消所有的物体, 用于整体替换Transform组件池(例如读取存档), 要在替换之前调用
+     */
+    void Reset();
+
+    /**
+     * @brief 到center的距离不超过radius的物体, 不分配内存
+     *
+     * @param callback bool(uint32_t entry), 返回false停止查询
+     */
+    template <typename Func>
+    void QueryRadius(const math::vec3 &center, float radius, Func &&callback) const
+    {
+        mGrid.QueryRadius(center, radius, [&](uint32_t index) { return Visit(index, callback); });
+    }
+
+    /**
+     * @brief 位置在包围盒内的物体, 不分配内存
+     *
+     * @param callback bool(uint32_t entry), 返回false停止查询
+     */
+    template <typename Func>
+    void QueryAABB(const AABB &box, Func &&callback) const
+    {
+        mGrid.QueryAABB(box, [&](uint32_t index) { return Visit(index, callback); });
+    }
+
+    const SpatialHashGrid &GetGrid() const
+    {
+        return mGrid;
+    }
+
+private:
+    struct Entry
+    {
+        components::Transform *transform = nullptr;
+        void                  *userData  = nullptr;
+        math::vec3             position{0.0f};
+    };
+
+    /**
+     * @brief 网格中的下标转换成条目编号, 跳过上一次Update之后被移除的条目
+     */
+    template <typename Func>
+    bool Visit(uint32_t index, Func &callback) const
+    {
+        auto entry = mGridEntries[index];
+        if (mEntries[entry].transform == nullptr)
+        {
+            return true;
+        }
+        return callback(entry);
+    }
+
+    void RemoveEntry(uint32_t entry);
+
+    SpatialHashGrid mGrid;
+
+    // 按条目编号存储, 被移除的条目的transform是nullptr
+    vector<Entry> mEntries;
+    // 可以复用的条目编号
+    vector<uint32_t> mFreeEntries;
+    // 上一次Update之后被移除的条目, 网格中还引用着它们, 下一次Update之后才能复用
+    vector<uint32_t> mPendingFreeEntries;
+
+    // transform -> 条目编号, transform被销毁时移除条目
+    TransformTracker mTracker{[this](uint32_t entry) { RemoveEntry(entry); }};
+
+    // 构建网格时的条目编号和位置, 网格中的下标指向这里
+    vector<uint32_t>   mGridEntries;
+    vector<math::vec3> mGridPositions;
+};
+} // namespace solis
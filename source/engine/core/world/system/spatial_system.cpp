@@ -0,0 +1,104 @@
+#include "core/world/system/spatial_system.hpp"
+
+#include "core/world/system/transform_system.hpp"
+
+namespace solis {
+static_assert(SpatialSystem::InvalidProxy == TransformTracker::InvalidIndex);
+
+void SpatialSystem::Update()
+{
+    // 只有世界矩阵被重新计算过的transform需要更新包围盒, 还在放大的包围盒内时树不会被修改
+    for (auto transform : TransformSystem::Get()->GetMovedTransforms())
+    {
+        auto proxy = FindProxy(*transform);
+        if (proxy == InvalidProxy)
+        {
+            continue;
+        }
+
+        auto &data       = mProxies[proxy];
+        data.worldBounds = data.localBounds.Transformed(transform->GetWorldMatrix());
+        mTree.Move(proxy, data.worldBounds);
+    }
+}
+
+uint32_t SpatialSystem::Insert(components::Transform &transform, const AABB &localBounds, void *userData)
+{
+    assert(transform.mEntityID.IsValid() && "SpatialSystem::Insert: transform must be allocated from the pool");
+
+    auto proxy = mTracker.Remove(transform);
+    if (proxy != InvalidProxy)
+    {
+        RemoveProxy(proxy);
+    }
+
+    auto worldBounds = localBounds.Transformed(transform.GetWorldMatrix());
+    proxy            = mTree.Insert(worldBounds, userData);
+    if (proxy >= mProxies.size())
+    {
+        mProxies.resize(std::max<size_t>(proxy + 1, mProxies.size() * 2));
+    }
+    mProxies[proxy] = {&transform, localBounds, worldBounds};
+    mTracker.Add(transform, proxy);
+    return proxy;
+}
+
+void SpatialSystem::Remove(const components::Transform &transform)
+{
+    auto proxy = mTracker.Remove(transform);
+    if (proxy != InvalidProxy)
+    {
+        RemoveProxy(proxy);
+    }
+}
+
+void SpatialSystem::SetLocalBounds(const components::Transform &transform, const AABB &localBounds)
+{
+    auto proxy = FindProxy(transform);
+    if (proxy == InvalidProxy)
+    {
+        return;
+    }
+
+    auto &data       = mProxies[proxy];
+    data.localBounds = localBounds;
+    data.worldBounds = localBounds.Transformed(transform.GetWorldMatrix());
+    mTree.Move(proxy, data.worldBounds);
+}
+
+uint32_t SpatialSystem::FindProxy(const components::Transform &transform) const
+{
+    return mTracker.Find(transform);
+}
+
+void SpatialSystem::Reset()
+{
+    mTracker.Clear();
+    mTree.Clear();
+    mProxies.clear();
+}
+
+uint32_t SpatialSystem::RayCastClosest(const Ray &ray, float &distance) const
+{
+    auto invDirection = 1.0f / ray.direction;
+    auto closest      = InvalidProxy;
+    mTree.RayCast(ray, [&](uint32_t proxy, const Ray &clipped) {
+        float tEnter = 0.0f;
+        if (!clipped.Intersects(mProxies[proxy].worldBounds, invDirection, tEnter))
+        {
+            return clipped.maxDistance;
+        }
+
+        closest  = proxy;
+        distance = tEnter;
+        return tEnter;
+    });
+    return closest;
+}
+
+void SpatialSystem::RemoveProxy(uint32_t proxy)
+{
+    mProxies[proxy] = Proxy();
+    mTree.Remove(proxy);
+}
+} // namespace solis
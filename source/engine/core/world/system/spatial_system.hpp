@@ -0,0 +1,179 @@
+#pragma once
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+#include "core/data/system.hpp"
+#include "core/math/bounds.hpp"
+#include "core/math/dynamic_bvh.hpp"
+#include "core/world/component/transform.hpp"
+#include "core/world/system/transform_tracker.hpp"
+
+namespace solis {
+/**
+ * @brief 场景的空间索引, 代理的世界包围盒是 局部包围盒 * transform的世界矩阵
+ * 在TransformSystem::Update之后更新, 只处理世界矩阵被重新计算过的transform
+ * 剔除, 拾取, 物理和游戏逻辑共用这棵树
+ */
+class SOLIS_CORE_API SpatialSystem : public System<SpatialSystem>, public EventHandler, public Object<SpatialSystem>
+{
+public:
+    OBJECT_NEW_DELETE(SpatialSystem)
+
+    inline static const uint32_t InvalidProxy = DynamicBVH::NullNode;
+
+    virtual ~SpatialSystem() = default;
+
+    virtual void Update() override;
+
+    /**
+     * @brief 插入一个物体, transform被释放时代理会被自动删除, O(log n)
+     * 一个transform只能有一个代理, 重复插入时更新局部包围盒和userData
+     *
+     * @param transform 必须是从组件池中分配的
+     * @param localBounds 局部空间的包围盒, 例如components::Mesh::GetLocalBounds
+     * @param userData 查询时返回给调用者
+     * @return uint32_t 代理编号
+     */
+    uint32_t Insert(components::Transform &transform, const AABB &localBounds, void *userData = nullptr);
+
+    /**
+     * @brief 删除transform的代理, 没有代理时什么都不做, O(log n)
+     */
+    void Remove(const components::Transform &transform);
+
+    /**
+     * @brief 修改局部包围盒, 例如切换了mesh
+     */
+    void SetLocalBounds(const components::Transform &transform, const AABB &localBounds);
+
+    /**
+     * @brief transform的代理, 没有时返回InvalidProxy, O(1)
+     */
+    uint32_t FindProxy(const components::Transform &transform) const;
+
+    /**
+     * @brief 代理的准确的世界包围盒(没有放大)
+     */
+    const AABB &GetWorldBounds(uint32_t proxy) const
+    {
+        return mProxies[proxy].worldBounds;
+    }
+
+    components::Transform *GetTransform(uint32_t proxy) const
+    {
+        return mProxies[proxy].transform;
+    }
+
+    void *GetUserData(uint32_t proxy) const
+    {
+        return mTree.GetUserData(proxy);
+    }
+
+    size_t Count() const
+    {
+        return mTree.Count();
+    }
+
+    /**
+     * @brief 取消所有的代理, 用于整体替换Transform组件池(例如读取存档), 要在替换之前调用
+     */
+    void Reset();
+
+    /**
+     * @brief 和aabb重叠的代理, 先用放大的包围盒过滤, 再用准确的世界包围盒测试
+     *
+     * @param callback bool(uint32_t proxy), 返回false停止查询
+     */
+    template <typename Func>
+    void QueryAABB(const AABB &aabb, Func &&callback) const
+    {
+        mTree.QueryAABB(aabb, [&](uint32_t proxy) {
+            if (!mProxies[proxy].worldBounds.Overlaps(aabb))
+            {
+                return true;
+            }
+            return callback(proxy);
+        });
+    }
+
+    /**
+     * @brief 和视锥体相交的代理
+     *
+     * @param callback void(uint32_t proxy)
+     */
+    template <typename Func>
+    void QueryFrustum(const Frustum &frustum, Func &&callback) const
+    {
+        mTree.QueryFrustum(frustum, [&](uint32_t proxy, bool inside) {
+            if (inside || frustum.Intersects(mProxies[proxy].worldBounds))
+            {
+                callback(proxy);
+            }
+        });
+    }
+
+    /**
+     * @brief 沿着射线查询, 见DynamicBVH::RayCast
+     *
+     * @param callback float(uint32_t proxy, const Ray &ray)
+     */
+    template <typename Func>
+    void RayCast(const Ray &ray, Func &&callback) const
+    {
+        auto invDirection = 1.0f / ray.direction;
+        mTree.RayCast(ray, [&](uint32_t proxy, const Ray &clipped) {
+            float tEnter = 0.0f;
+            if (!clipped.Intersects(mProxies[proxy].worldBounds, invDirection, tEnter))
+            {
+                return clipped.maxDistance;
+            }
+            return callback(proxy, clipped);
+        });
+    }
+
+    /**
+     * @brief 射线第一个命中的世界包围盒
+     *
+     * @param ray
+     * @param distance 输出命中时的t
+     * @return uint32_t 没有命中时返回InvalidProxy
+     */
+    uint32_t RayCastClosest(const Ray &ray, float &distance) const;
+
+    /**
+     * @brief 世界包围盒离point最近的代理
+     *
+     * @return uint32_t 没有找到时返回InvalidProxy
+     */
+    uint32_t Nearest(const math::vec3 &point, float maxDistance = FLT_MAX) const
+    {
+        return mTree.Nearest(
+            point, [&](uint32_t proxy) { return mProxies[proxy].worldBounds.DistanceSquared(point); }, maxDistance);
+    }
+
+    const DynamicBVH &GetTree() const
+    {
+        return mTree;
+    }
+
+private:
+    struct Proxy
+    {
+        components::Transform *transform = nullptr;
+        AABB                   localBounds;
+        AABB                   worldBounds;
+    };
+
+    void RemoveProxy(uint32_t proxy);
+
+    DynamicBVH mTree;
+
+    // 按代理编号存储, 代理编号和树的节点共用编号, 所以中间会有空位
+    vector<Proxy> mProxies;
+
+    // transform -> 代理编号, transform被销毁时删除代理
+    TransformTracker mTracker{[this](uint32_t proxy) { RemoveProxy(proxy); }};
+};
+} // namespace solis
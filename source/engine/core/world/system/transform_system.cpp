@@ -1,115 +1,360 @@
 #include "core/world/system/transform_system.hpp"
 
+#include "core/base/job_system.hpp"
+
 namespace solis {
 
 void TransformSystem::Update()
 {
-    // TODO: 这里可以根据被观察的对象进行一个线性优化的过程
-    // 不过目前这里使用的list+指针，所以目前还不需要进行到这一步
+    if (mHierarchyChanged)
+    {
+        RebuildHierarchy();
+    }
+
+    // 没有被修改过的节点整块跳过, 不再通过OnChanged事件逐个通知
+    mChangedTransforms.clear();
+    mChangeVersion = components::Transform::GetPool().ForEachChanged(mChangeVersion, [this](components::Transform &transform) {
+        auto node = FindNode(transform);
+        if (node == InvalidIndex)
+        {
+            return;
+        }
+
+        mChangedTransforms.push_back(&transform);
+        auto flatIndex = mNodeFlatIndices[node];
+        if (transform.IsDirty() && flatIndex != InvalidIndex)
+        {
+            mFlatDirty[flatIndex] = 1;
+            StoreLocal(flatIndex, transform);
+        }
+    });
+
+    PropagateWorldMatrices();
 }
 
-void TransformSystem::Watch(components::Transform &transform)
+void TransformSystem::RebuildHierarchy()
 {
-    if (mTransformNodeMap.find(&transform) != mTransformNodeMap.end())
+    mFlatTransforms.clear();
+    mFlatParents.clear();
+    mLevelOffsets.clear();
+
+    // 重新排列之前的扁平下标, 用来保留没有改变父节点的节点的脏标记和世界矩阵
+    vector<uint32_t> oldFlatIndices(mNodeFlatIndices.begin(), mNodeFlatIndices.end());
+
+    // 按层广度优先, 已经放入的节点就是下一层的父节点
+    vector<uint32_t> order;
+    order.reserve(mNodeCount);
+    for (uint32_t node = 0; node < mNodeTransforms.size(); ++node)
     {
-        return;
+        // 成环的节点不会从根节点被访问到
+        mNodeFlatIndices[node] = InvalidIndex;
+        if (mNodeTransforms[node] != nullptr && mNodeParents[node] == InvalidIndex)
+        {
+            mNodeFlatIndices[node] = static_cast<uint32_t>(order.size());
+            order.push_back(node);
+            mFlatParents.push_back(InvalidIndex);
+        }
     }
 
-    mTransformNodes.emplace_back(nullptr);
-    mTransformNodes.back().transform = &transform;
-    mTransformNodeMap[&transform]    = &mTransformNodes.back();
+    // 遍历完一层时, 已经放入的节点就是下一层
+    mLevelOffsets.push_back(0);
+    size_t levelEnd = order.size();
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        if (i == levelEnd)
+        {
+            mLevelOffsets.push_back(static_cast<uint32_t>(i));
+            levelEnd = order.size();
+        }
+        for (auto child = mNodeFirstChilds[order[i]]; child != InvalidIndex; child = mNodeNextSiblings[child])
+        {
+            mNodeFlatIndices[child] = static_cast<uint32_t>(order.size());
+            order.push_back(child);
+            mFlatParents.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    mLevelOffsets.push_back(static_cast<uint32_t>(order.size()));
 
-    mRoot.children.emplace_back(&mTransformNodes.back());
+    mFlatTransforms.reserve(order.size());
+    mLocalTRS.Resize(order.size());
+    for (auto node : order)
+    {
+        StoreLocal(mFlatTransforms.size(), *mNodeTransforms[node]);
+        mFlatTransforms.push_back(mNodeTransforms[node]);
+    }
 
-    transform.OnChanged += [this](const TransformChangedEvent &event) -> bool {
-        return this->OnTransformChanged(event);
-    };
+    // 只有新观察的节点和父节点改变了的子树需要重新计算, 子树中的其他节点在传递脏标记时被标记
+    // 其他节点从旧的位置搬过来, 子节点计算时会用到父节点的世界矩阵
+    vector<uint8_t>    flatDirty(order.size());
+    vector<math::mat4> worldMatrices(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        auto node    = order[i];
+        auto oldFlat = oldFlatIndices[node];
+        if (oldFlat == InvalidIndex || mNodeReparented[node] != 0)
+        {
+            flatDirty[i] = 1;
+        }
+        else
+        {
+            flatDirty[i]     = mFlatDirty[oldFlat];
+            worldMatrices[i] = mWorldMatrices[oldFlat];
+        }
+        mNodeReparented[node] = 0;
+    }
+    mFlatDirty.swap(flatDirty);
+    mWorldMatrices.swap(worldMatrices);
+    mLocalMatrices.resize(order.size());
+    mHierarchyChanged = false;
+}
+
+void TransformSystem::PropagateWorldMatrices()
+{
+    auto begin = std::chrono::steady_clock::now();
 
-    transform.OnExpired += [this](const TransformExpiredEvent &event) -> bool {
-        return this->OnTransformExpired(event);
-    };
+    // 每一层只依赖上一层的结果, 层与层之间是一个同步点
+    auto jobSystem = JobSystem::Get();
+    for (size_t level = 0; level + 1 < mLevelOffsets.size(); ++level)
+    {
+        size_t first = mLevelOffsets[level];
+        size_t count = mLevelOffsets[level + 1] - first;
+        jobSystem->ParallelFor(count, TransformJobGrain, [this, first](size_t begin, size_t end) {
+            PropagateRange(first + begin, first + end);
+        });
+    }
+
+    // 包括因为父节点移动而移动的子节点
+    mMovedTransforms.clear();
+    for (size_t i = 0; i < mFlatDirty.size(); ++i)
+    {
+        if (mFlatDirty[i] != 0)
+        {
+            mMovedTransforms.push_back(mFlatTransforms[i]);
+        }
+    }
+    std::fill(mFlatDirty.begin(), mFlatDirty.end(), 0);
+
+    mPropagateTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
 }
 
-void TransformSystem::UnWatch(components::Transform &transform)
+void TransformSystem::PropagateRange(size_t begin, size_t end)
 {
-    if (mTransformNodeMap.find(&transform) != mTransformNodeMap.end())
+    // 父节点在上一层, 它的脏标记已经向下传递过了
+    for (size_t i = begin; i < end; ++i)
     {
-        auto &node = GetTransformNode(transform);
-        if (node.parent)
+        auto parent = mFlatParents[i];
+        if (parent != InvalidIndex)
         {
-            node.parent->children.remove(&node);
+            mFlatDirty[i] |= mFlatDirty[parent];
         }
-        for (auto &child : node.children)
+    }
+
+    for (size_t group = begin; group < end; group += 8)
+    {
+        auto groupEnd = std::min(group + 8, end);
+        if (std::find(mFlatDirty.begin() + group, mFlatDirty.begin() + groupEnd, 1) != mFlatDirty.begin() + groupEnd)
         {
-            // TODO: 这里可能就变成了游离节点了
-            // 或许这里可以做一个小小优化
-            child->parent = nullptr;
+            mLocalTRS.Compose(group, groupEnd, mLocalMatrices.data());
         }
-        mTransformNodes.remove(node);
-        mTransformNodeMap.erase(&transform);
+    }
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (mFlatDirty[i] == 0)
+        {
+            continue;
+        }
+
+        auto parent       = mFlatParents[i];
+        mWorldMatrices[i] = parent == InvalidIndex ? mLocalMatrices[i] : mWorldMatrices[parent] * mLocalMatrices[i];
+
+        auto transform          = mFlatTransforms[i];
+        transform->mWorldMatrix = mWorldMatrices[i];
+        transform->mDirty       = false;
     }
 }
 
-bool TransformSystem::IsWatched(components::Transform &transform)
+void TransformSystem::StoreLocal(size_t flatIndex, const components::Transform &transform)
 {
-    return mTransformNodeMap.find(&transform) != mTransformNodeMap.end();
+    mLocalTRS.Set(flatIndex, transform.GetPosition(), math::quat(transform.GetRotation()), transform.GetScale());
 }
 
-void TransformSystem::SetParent(components::Transform &base, components::Transform &parent)
+void TransformSystem::Watch(components::Transform &transform)
 {
-    auto &node       = GetTransformNode(base);
-    auto &parentNode = GetTransformNode(parent);
+    assert(transform.mEntityID.IsValid() && "TransformSystem::Watch: transform must be allocated from the pool");
 
-    if (node.parent)
+    if (FindNode(transform) != InvalidIndex)
     {
-        node.parent->children.remove(&node);
+        return;
     }
 
-    node.parent = &parentNode;
-    parentNode.children.emplace_back(&node);
+    uint32_t node = mFreeNode;
+    if (node != InvalidIndex)
+    {
+        mFreeNode = mNodeNextSiblings[node];
+    }
+    else
+    {
+        node = static_cast<uint32_t>(mNodeTransforms.size());
+        mNodeTransforms.emplace_back();
+        mNodeParents.emplace_back();
+        mNodeFirstChilds.emplace_back();
+        mNodeNextSiblings.emplace_back();
+        mNodePrevSiblings.emplace_back();
+        mNodeFlatIndices.emplace_back();
+        mNodeReparented.emplace_back();
+    }
+
+    mNodeTransforms[node]   = &transform;
+    mNodeParents[node]      = InvalidIndex;
+    mNodeFirstChilds[node]  = InvalidIndex;
+    mNodeNextSiblings[node] = InvalidIndex;
+    mNodePrevSiblings[node] = InvalidIndex;
+    mNodeFlatIndices[node]  = InvalidIndex;
+    mNodeReparented[node]   = 1;
+    mNodeCount++;
+    mHierarchyChanged = true;
+
+    mTracker.Add(transform, node);
 }
 
-components::Transform *TransformSystem::GetParent(components::Transform &base)
+void TransformSystem::Watch(std::span<components::Transform *const> transforms)
+{
+    auto count = mNodeCount + transforms.size();
+    mNodeTransforms.reserve(count);
+    mNodeParents.reserve(count);
+    mNodeFirstChilds.reserve(count);
+    mNodeNextSiblings.reserve(count);
+    mNodePrevSiblings.reserve(count);
+    mNodeFlatIndices.reserve(count);
+    mNodeReparented.reserve(count);
+    for (auto transform : transforms)
+    {
+        Watch(*transform);
+    }
+}
+
+void TransformSystem::UnWatch(components::Transform &transform)
+{
+    auto node = mTracker.Remove(transform);
+    if (node != InvalidIndex)
+    {
+        RemoveNode(node);
+    }
+}
+
+void TransformSystem::Reset()
+{
+    mTracker.Clear();
+    mNodeTransforms.clear();
+    mNodeParents.clear();
+    mNodeFirstChilds.clear();
+    mNodeNextSiblings.clear();
+    mNodePrevSiblings.clear();
+    mNodeFlatIndices.clear();
+    mNodeReparented.clear();
+    mFreeNode  = InvalidIndex;
+    mNodeCount = 0;
+
+    mChangedTransforms.clear();
+    mMovedTransforms.clear();
+    mHierarchyChanged = true;
+}
+
+bool TransformSystem::IsWatched(const components::Transform &transform) const
 {
-    if (mTransformNodeMap.find(&base) != mTransformNodeMap.end())
+    return FindNode(transform) != InvalidIndex;
+}
+
+void TransformSystem::SetParent(components::Transform &base, components::Transform &parent)
+{
+    Watch(base);
+    Watch(parent);
+
+    auto node       = FindNode(base);
+    auto parentNode = FindNode(parent);
+
+    // parent不能是base自己或者base的子孙
+    for (auto ancestor = parentNode; ancestor != InvalidIndex; ancestor = mNodeParents[ancestor])
     {
-        auto &node = mTransformNodeMap[&base];
-        if (node->parent != nullptr)
+        if (ancestor == node)
         {
-            return node->parent->transform;
+            return;
         }
     }
-    return nullptr;
+
+    Detach(node);
+
+    mNodeParents[node]      = parentNode;
+    mNodeNextSiblings[node] = mNodeFirstChilds[parentNode];
+    if (mNodeFirstChilds[parentNode] != InvalidIndex)
+    {
+        mNodePrevSiblings[mNodeFirstChilds[parentNode]] = node;
+    }
+    mNodeFirstChilds[parentNode] = node;
+    mNodeReparented[node]        = 1;
+    mHierarchyChanged            = true;
 }
 
-TransformSystem::TransformNode &TransformSystem::GetTransformNode(components::Transform &transform)
+components::Transform *TransformSystem::GetParent(components::Transform &base)
 {
-    if (mTransformNodeMap.find(&transform) != mTransformNodeMap.end())
+    auto node = FindNode(base);
+    if (node == InvalidIndex || mNodeParents[node] == InvalidIndex)
     {
-        return *mTransformNodeMap[&transform];
+        return nullptr;
     }
+    return mNodeTransforms[mNodeParents[node]];
+}
 
-    mTransformNodes.emplace_back(&transform);
-    auto &node                    = mTransformNodes.back();
-    mTransformNodeMap[&transform] = &node;
-
-    return node;
+uint32_t TransformSystem::FindNode(const components::Transform &transform) const
+{
+    return mTracker.Find(transform);
 }
 
-bool TransformSystem::OnTransformExpired(const TransformExpiredEvent &event)
+void TransformSystem::Detach(uint32_t node)
 {
-    UnWatch(*const_cast<components::Transform *>(event.transform));
+    auto parent = mNodeParents[node];
+    if (parent == InvalidIndex)
+    {
+        return;
+    }
+
+    auto prev = mNodePrevSiblings[node];
+    auto next = mNodeNextSiblings[node];
+    if (prev != InvalidIndex)
+    {
+        mNodeNextSiblings[prev] = next;
+    }
+    else
+    {
+        mNodeFirstChilds[parent] = next;
+    }
+    if (next != InvalidIndex)
+    {
+        mNodePrevSiblings[next] = prev;
+    }
 
-    return false;
+    mNodeParents[node]      = InvalidIndex;
+    mNodeNextSiblings[node] = InvalidIndex;
+    mNodePrevSiblings[node] = InvalidIndex;
+    mNodeReparented[node]   = 1;
+    mHierarchyChanged       = true;
 }
 
-bool TransformSystem::OnTransformChanged(const TransformChangedEvent &event)
+void TransformSystem::RemoveNode(uint32_t node)
 {
-    if (!IsWatched(*const_cast<components::Transform *>(event.transform)))
+    // 子节点变成根节点, 和Detach一样保留它们的局部TRS, 下一次Update时世界矩阵就等于局部矩阵
+    // 它们不会被释放, 之后可以通过SetParent重新挂到别的节点下
+    Detach(node);
+    while (mNodeFirstChilds[node] != InvalidIndex)
     {
-        return false;
+        Detach(mNodeFirstChilds[node]);
     }
 
-    return false;
+    mNodeTransforms[node]   = nullptr;
+    mNodeNextSiblings[node] = mFreeNode;
+    mFreeNode               = node;
+    mNodeCount--;
+    mHierarchyChanged = true;
 }
-} // namespace solis
\ No newline at end of file
+} // namespace solis
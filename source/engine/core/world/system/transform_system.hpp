@@ -1,6 +1,9 @@
 
 #pragma once
 
+#include <chrono>
+#include <span>
+
 #include "core/solis_core.hpp"
 #include "core/base/object.hpp"
 #include "core/base/using.hpp"
@@ -8,7 +11,9 @@
 #include "core/data/system.hpp"
 #include "core/data/game_object.hpp"
 
+#include "core/math/transform_soa.hpp"
 #include "core/world/component/transform.hpp"
+#include "core/world/system/transform_tracker.hpp"
 
 namespace solis {
 class SOLIS_CORE_API TransformSystem : public System<TransformSystem>, public EventHandler, public Object<TransformSystem>
@@ -34,18 +39,31 @@ public:
 
     /**
      * @brief 观察一个transform，如果transform被释放了，那么这个transform将会被移除
+     * transform必须是从组件池中分配的(有合法的EntityID), O(1)
      *
      * @param transform
      */
     void Watch(components::Transform &transform);
 
     /**
-     * @brief 取消观察一个transform
+     * @brief 批量观察transform, 只扩容一次, 用于批量实例化
+     *
+     * @param transforms
+     */
+    void Watch(std::span<components::Transform *const> transforms);
+
+    /**
+     * @brief 取消观察一个transform, 它的子节点变成根节点, O(子节点数量)
      *
      * @param transform
      */
     void UnWatch(components::Transform &transform);
 
+    /**
+     * @brief 取消观察所有的transform, 用于整体替换Transform组件池(例如读取存档), 要在替换之前调用
+     */
+    void Reset();
+
     /**
      * @brief 判断一个transform是否被观察
      *
@@ -53,12 +71,13 @@ public:
      * @return true
      * @return false
      */
-    bool IsWatched(components::Transform &transform);
+    bool IsWatched(const components::Transform &transform) const;
 
     /**
      * @brief Set the Parent object, 如果parent被释放了
-     *        那么base将会在整个系统中被移除，但是不会被释放
+     *        那么base将会变成根节点，但是不会被释放
      *        除非重新加入到一个新的parent中, 或者手动释放
+     *        没有被观察的transform会先被观察, 会形成环的调用会被忽略, O(depth)
      *
      * @param base
      * @param parent
@@ -73,44 +92,113 @@ public:
      */
     components::Transform *GetParent(components::Transform &base);
 
-private:
-    struct TransformNode
+    /**
+     * @brief 上一次Update时所在节点被修改过的transform, 渲染提取等可以只处理这些
+     * 同一个节点中没有被修改的transform也会出现在这里
+     *
+     * @return const vector<components::Transform *>&
+     */
+    const vector<components::Transform *> &GetChangedTransforms() const
     {
-        components::Transform     *transform = nullptr;
-        TransformNode             *parent    = nullptr;
-        std::list<TransformNode *> children;
-
-        bool operator==(const TransformNode &other) const
-        {
-            return transform == other.transform && parent == other.parent && children == other.children;
-        }
-    };
+        return mChangedTransforms;
+    }
 
     /**
-     * @brief Get the Transform Node object
+     * @brief 上一次Update中世界矩阵被重新计算过的transform, 包括只因为父节点移动而移动的子节点
+     * 空间索引等依赖世界矩阵的系统只需要处理这些
      *
-     * @param transform
-     * @return TransformNode&
+     * @return const vector<components::Transform *>&
      */
-    TransformNode &GetTransformNode(components::Transform &transform);
+    const vector<components::Transform *> &GetMovedTransforms() const
+    {
+        return mMovedTransforms;
+    }
 
     /**
-     * @brief 这里使用事件去触发
+     * @brief 上一次Update中计算世界矩阵所用的时间, 用于观察多线程的扩展性
+     * 工作线程的数量由JobSystem::SetWorkerCount控制
      *
-     * @param transform
+     * @return std::chrono::nanoseconds
      */
-    bool OnTransformExpired(const TransformExpiredEvent &event);
+    std::chrono::nanoseconds GetPropagateTime() const
+    {
+        return mPropagateTime;
+    }
+
+private:
+    inline static const uint32_t InvalidIndex = TransformTracker::InvalidIndex;
 
     /**
-     * @brief 这里使用事件去触发
-     *
-     * @param transform
+     * @brief 查找transform对应的节点下标, 没有被观察时返回InvalidIndex, O(1)
+     */
+    uint32_t FindNode(const components::Transform &transform) const;
+
+    /**
+     * @brief 把节点从父节点的子节点链表中摘下, 变成根节点, O(1)
+     */
+    void Detach(uint32_t node);
+
+    /**
+     * @brief 释放节点, 子节点变成根节点
+     */
+    void RemoveNode(uint32_t node);
+
+    /**
+     * @brief 层级改变之后重新生成扁平层级, 按深度排序, 父节点总是排在子节点前面
+     * 没有改变父节点的节点保留脏标记和世界矩阵, 生成或销毁一个对象不会让整个场景重新计算
+     */
+    void RebuildHierarchy();
+
+    /**
+     * @brief 按层遍历, 只重新计算被修改过的子树的世界矩阵
+     * 同一层的节点互相独立, 在JobSystem上并行计算, 每个节点的结果和线程数无关
      */
-    bool OnTransformChanged(const TransformChangedEvent &event);
+    void PropagateWorldMatrices();
 
-    // TODO: 这里可以做线性优化，不过预计需要花很多时间，先用list把
-    TransformNode                                      mRoot;
-    std::list<TransformNode>                           mTransformNodes;
-    dict_map<components::Transform *, TransformNode *> mTransformNodeMap;
+    /**
+     * @brief 计算扁平层级中[begin, end)的世界矩阵, 父节点必须已经计算过
+     * 局部矩阵按8个一组从SoA中批量组合, 组内没有被修改的transform时整组跳过
+     */
+    void PropagateRange(size_t begin, size_t end);
+
+    /**
+     * @brief 把transform的TRS复制到扁平层级的SoA中
+     */
+    void StoreLocal(size_t flatIndex, const components::Transform &transform);
+
+    // 按节点下标存储的层级, 子节点用 第一个子节点 + 兄弟链表 表示, 被释放的节点串在空闲链表上
+    vector<components::Transform *> mNodeTransforms;
+    vector<uint32_t>                mNodeParents;
+    vector<uint32_t>                mNodeFirstChilds;
+    vector<uint32_t>                mNodeNextSiblings;
+    vector<uint32_t>                mNodePrevSiblings;
+    // 节点在扁平层级中的下标
+    vector<uint32_t> mNodeFlatIndices;
+    // 上一次重建扁平层级之后被新观察或者改变了父节点, 重建时整棵子树需要重新计算世界矩阵
+    vector<uint8_t> mNodeReparented;
+    uint32_t         mFreeNode  = InvalidIndex;
+    size_t           mNodeCount = 0;
+
+    // transform -> 节点下标, transform被销毁时释放节点
+    TransformTracker mTracker{[this](uint32_t node) { RemoveNode(node); }};
+
+    // 扁平层级, 按深度排序, 根节点的父节点是InvalidIndex
+    vector<components::Transform *> mFlatTransforms;
+    vector<uint32_t>                mFlatParents;
+    vector<uint8_t>                 mFlatDirty;
+    vector<math::mat4>              mWorldMatrices;
+    // 按扁平层级顺序存储的局部TRS和组合出的局部矩阵
+    TransformSoA       mLocalTRS;
+    vector<math::mat4> mLocalMatrices;
+    // 每一层在扁平层级中的起始下标, 最后一个元素是节点总数
+    vector<uint32_t> mLevelOffsets;
+    bool             mHierarchyChanged = true;
+
+    std::chrono::nanoseconds mPropagateTime{0};
+
+    // Transform组件池的修改版本, 见ObjectPool::ForEachChanged
+    uint32_t                        mChangeVersion = 0;
+    vector<components::Transform *> mChangedTransforms;
+    vector<components::Transform *> mMovedTransforms;
 };
 } // namespace solis
@@ -0,0 +1,101 @@
+#include "core/world/system/transform_tracker.hpp"
+
+namespace solis {
+void TransformTracker::Add(components::Transform &transform, uint32_t index)
+{
+    assert(transform.mEntityID.IsValid() && "TransformTracker::Add: transform must be allocated from the pool");
+
+    // OnExpired是在Transform::OnDestroy中同步发出的, 被销毁的transform的记录已经被移除了, 句柄不会还被占用着
+    auto handle = transform.mEntityID.GetIndex();
+    if (handle >= mRecords.size())
+    {
+        mRecords.resize(std::max<size_t>(handle + 1, mRecords.size() * 2));
+    }
+
+    auto &record = mRecords[handle];
+    assert(record.transform == nullptr && "TransformTracker::Add: transform is already tracked");
+
+    record.transform = &transform;
+    record.entity    = transform.mEntityID;
+    record.index     = index;
+    record.expired   = transform.OnExpired.Subscribe([this](const TransformExpiredEvent &event) -> bool {
+        return this->OnTransformExpired(event);
+    });
+    mCount++;
+}
+
+uint32_t TransformTracker::Remove(const components::Transform &transform)
+{
+    auto handle = FindHandle(&transform, transform.mEntityID);
+    if (handle == InvalidIndex)
+    {
+        return InvalidIndex;
+    }
+
+    auto &record = mRecords[handle];
+    auto  index  = record.index;
+    record.transform->OnExpired.Unsubscribe(record.expired);
+    record = Record();
+    mCount--;
+    return index;
+}
+
+void TransformTracker::SetIndex(const components::Transform &transform, uint32_t index)
+{
+    auto handle = FindHandle(&transform, transform.mEntityID);
+    assert(handle != InvalidIndex && "TransformTracker::SetIndex: transform is not tracked");
+    mRecords[handle].index = index;
+}
+
+uint32_t TransformTracker::Find(const components::Transform &transform) const
+{
+    auto handle = FindHandle(&transform, transform.mEntityID);
+    return handle != InvalidIndex ? mRecords[handle].index : InvalidIndex;
+}
+
+void TransformTracker::Clear()
+{
+    if (mCount > 0)
+    {
+        for (auto &record : mRecords)
+        {
+            if (record.transform != nullptr)
+            {
+                record.transform->OnExpired.Unsubscribe(record.expired);
+            }
+        }
+    }
+    mRecords.clear();
+    mCount = 0;
+}
+
+uint32_t TransformTracker::FindHandle(const components::Transform *transform, EntityID id) const
+{
+    auto handle = id.GetIndex();
+    if (!id.IsValid() || handle >= mRecords.size())
+    {
+        return InvalidIndex;
+    }
+
+    auto &record = mRecords[handle];
+    if (record.transform != transform || record.entity.GetUint64() != id.GetUint64())
+    {
+        return InvalidIndex;
+    }
+    return handle;
+}
+
+bool TransformTracker::OnTransformExpired(const TransformExpiredEvent &event)
+{
+    // transform马上就会被销毁, 它的委托列表也会被清空, 不需要取消订阅
+    auto handle = FindHandle(event.transform, event.id);
+    if (handle != InvalidIndex)
+    {
+        auto index       = mRecords[handle].index;
+        mRecords[handle] = Record();
+        mCount--;
+        mExpired(index);
+    }
+    return false;
+}
+} // namespace solis
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+#include "core/base/delegate.hpp"
+#include "core/base/i_noncopyable.hpp"
+#include "core/world/component/transform.hpp"
+
+namespace solis {
+/**
+ * @brief 系统用来记录自己管理的transform, 按Transform的EntityID下标找到系统中的编号(节点, 代理, 条目等), O(1)
+ * 记录时订阅OnExpired, transform被销毁时移除记录并通过回调通知系统, 主动移除和Clear时取消订阅
+ *
+ * 回调捕获了this, 所以不能被复制或者移动, 作为系统的成员使用
+ */
+class SOLIS_CORE_API TransformTracker : public INonCopyable
+{
+public:
+    inline static const uint32_t InvalidIndex = 0xFFFFFFFF;
+
+    /**
+     * @param expired transform被销毁时调用, void(uint32_t index), 这时记录已经被移除了
+     */
+    explicit TransformTracker(Delegate<void(uint32_t index)> &&expired) :
+        mExpired(std::move(expired))
+    {
+    }
+
+    /**
+     * @brief 记录transform对应的编号, transform不能已经被记录
+     *
+     * @param transform 必须是从组件池中分配的
+     */
+    void Add(components::Transform &transform, uint32_t index);
+
+    /**
+     * @brief 移除记录并取消OnExpired的订阅
+     *
+     * @return uint32_t 之前记录的编号, 没有记录时返回InvalidIndex
+     */
+    uint32_t Remove(const components::Transform &transform);
+
+    /**
+     * @brief 修改已经记录的transform对应的编号, 用于系统移动了自己的数据
+     */
+    void SetIndex(const components::Transform &transform, uint32_t index);
+
+    /**
+     * @brief transform对应的编号, 没有记录时返回InvalidIndex
+     */
+    uint32_t Find(const components::Transform &transform) const;
+
+    /**
+     * @brief 移除所有的记录并取消订阅, 用于整体替换Transform组件池(例如读取存档)
+     * 被销毁的transform已经通过OnExpired移除了, 剩下的都还存活, 所以要在替换组件池之前调用
+     */
+    void Clear();
+
+private:
+    struct Record
+    {
+        components::Transform *transform = nullptr;
+        EntityID               entity;
+        uint32_t               index = InvalidIndex;
+        // OnExpired的订阅, 主动移除时取消, 避免之后重新记录时重复订阅
+        EventProperty<TransformExpiredEvent>::Token expired = 0;
+    };
+
+    /**
+     * @brief 记录所在的句柄下标, 没有记录时返回InvalidIndex
+     * 句柄下标会被复用, 需要确认记录的仍然是同一代的Entity
+     */
+    uint32_t FindHandle(const components::Transform *transform, EntityID id) const;
+
+    bool OnTransformExpired(const TransformExpiredEvent &event);
+
+    // 按Transform的EntityID下标存储
+    vector<Record> mRecords;
+    size_t         mCount = 0;
+
+    Delegate<void(uint32_t index)> mExpired;
+};
+} // namespace solis
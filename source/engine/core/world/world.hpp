@@ -6,6 +6,13 @@
 #include "core/base/using.hpp"
 
 #include "core/world/world_base.hpp"
+#include "core/world/system/transform_system.hpp"
+#include "core/world/system/spatial_system.hpp"
+#include "core/world/system/spatial_hash_system.hpp"
+#include "core/world/system/camera_system.hpp"
+#include "core/world/system/culling_system.hpp"
+#include "core/world/system/occlusion_system.hpp"
+#include "core/world/system/lod_system.hpp"
 #include "core/events/events.hpp"
 #include "core/events/event_define.hpp"
 
@@ -31,6 +38,28 @@ public:
     virtual void Update() override
     {
         mMainWorld->Update();
+
+        TransformSystem::Get()->Update();
+        SpatialSystem::Get()->Update();
+        SpatialHashSystem::Get()->Update();
+        CameraSystem::Get()->Update();
+        CullingSystem::Get()->Update();
+        OcclusionSystem::Get()->Update();
+        LodSystem::Get()->Update();
+    }
+
+    /**
+     * @brief 同步点, 由Engine::Step在Normal阶段之后调用, 此时没有系统在遍历组件
+     */
+    void SyncPoint()
+    {
+        if (mMainWorld != nullptr)
+        {
+            mMainWorld->GetCommandBuffer().Playback();
+        }
+
+        // 增量地压缩ObjectPool, 释放空出来的节点
+        ObjectPoolBase::CompactAll(std::chrono::microseconds(ObjectPoolCompactBudget));
     }
 
     void SetMainWorld(std::unique_ptr<WorldBase> &&world)
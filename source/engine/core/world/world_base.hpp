@@ -1,10 +1,12 @@
-
 #pragma once
 
 #include "core/solis_core.hpp"
 #include "core/base/object.hpp"
 #include "core/base/using.hpp"
 
+#include "core/data/archetype.hpp"
+#include "core/data/entity_command_buffer.hpp"
+
 namespace solis {
 class SOLIS_CORE_API WorldBase : public Object<WorldBase>
 {
@@ -14,5 +16,41 @@ public:
 
     virtual void Start(){};
     virtual void Update(){};
+
+    /**
+     * @brief 世界中按Archetype存储的数据组件
+     *
+     * @return ArchetypeStorage&
+     */
+    ArchetypeStorage &GetStorage()
+    {
+        return mStorage;
+    }
+
+    /**
+     * @brief 遍历所有同时拥有Ts...的Entity, 例如 world.Each<Position, Velocity>(func)
+     *
+     * @tparam Ts
+     * @param func void(Ts &...) 或者 void(EntityID, Ts &...)
+     */
+    template <typename... Ts, typename Func>
+    void Each(Func &&func)
+    {
+        mStorage.Each<Ts...>(std::forward<Func>(func));
+    }
+
+    /**
+     * @brief 延迟执行的结构性修改, 系统遍历时或者在工作线程中记录, 在Engine::Step的同步点上回放
+     *
+     * @return EntityCommandBuffer&
+     */
+    EntityCommandBuffer &GetCommandBuffer()
+    {
+        return mCommandBuffer;
+    }
+
+protected:
+    ArchetypeStorage    mStorage;
+    EntityCommandBuffer mCommandBuffer;
 };
-} // namespace solis
\ No newline at end of file
+} // namespace solis
@@ -0,0 +1,69 @@
+#include "core/world/world_snapshot.hpp"
+
+#include "core/base/ecs.hpp"
+#include "core/base/snapshot.hpp"
+#include "core/files/file_info.hpp"
+#include "core/world/component/transform.hpp"
+#include "core/world/system/transform_system.hpp"
+#include "core/world/system/spatial_system.hpp"
+#include "core/world/system/spatial_hash_system.hpp"
+
+namespace solis {
+// 'SOLS'
+static const uint32_t SnapshotMagic   = 0x534C4F53;
+static const uint32_t SnapshotVersion = 1;
+
+vector<uint8_t> WorldSnapshot::Save()
+{
+    SnapshotWriter writer;
+    writer.Write(SnapshotMagic);
+    writer.Write(SnapshotVersion);
+
+    ObjectPoolBase::SaveAll(writer);
+    return std::move(writer.GetData());
+}
+
+bool WorldSnapshot::Load(const vector<uint8_t> &data)
+{
+    SnapshotReader reader(data.data(), data.size());
+
+    uint32_t magic   = 0;
+    uint32_t version = 0;
+    if (!reader.Read(magic) || !reader.Read(version) || magic != SnapshotMagic || version != SnapshotVersion)
+    {
+        return false;
+    }
+
+    // 旧的Transform会被直接析构, 不会发出OnExpired
+    auto transformSystem = TransformSystem::Get();
+    transformSystem->Reset();
+    // 代理指向旧的Transform, 需要由使用者重新插入
+    SpatialSystem::Get()->Reset();
+    SpatialHashSystem::Get()->Reset();
+
+    ObjectPoolBase::LoadAll(reader);
+
+    vector<components::Transform *> transforms;
+    transforms.reserve(components::Transform::GetPool().Count());
+    components::Transform::GetPool().ForEach([&](components::Transform &transform) {
+        transforms.push_back(&transform);
+    });
+    transformSystem->Watch(std::span<components::Transform *const>(transforms.data(), transforms.size()));
+    return true;
+}
+
+void WorldSnapshot::SaveToFile(const string &path)
+{
+    files::FileInfo(path).WriteBytes(Save());
+}
+
+bool WorldSnapshot::LoadFromFile(const string &path)
+{
+    files::FileInfo fileInfo(path);
+    if (!fileInfo.Exist())
+    {
+        return false;
+    }
+    return Load(fileInfo.ReadBytes());
+}
+} // namespace solis
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "core/solis_core.hpp"
+#include "core/base/object.hpp"
+#include "core/base/using.hpp"
+
+namespace solis {
+/**
+ * @brief 把所有ObjectPool中的组件整块地写入二进制存档, 或者从存档中恢复
+ * 平凡可拷贝的组件按节点整块memcpy, 其他组件需要特化SnapshotSerializer(见core/base/snapshot.hpp)
+ *
+ * 只保存组件池, GameObject和Transform的父子关系不会被保存, 需要由外部根据EntityID重新组装
+ * 只能在同步点上调用(没有系统在遍历组件, 没有线程在分配组件)
+ */
+class SOLIS_CORE_API WorldSnapshot
+{
+public:
+    /**
+     * @brief 保存所有支持存档的ObjectPool
+     *
+     * @return vector<uint8_t>
+     */
+    static vector<uint8_t> Save();
+
+    /**
+     * @brief 从存档中恢复ObjectPool, 已有的组件会被直接析构, 所以调用前不能有GameObject持有池中的组件
+     * 恢复之后所有Transform都会重新被TransformSystem观察
+     *
+     * @param data
+     * @return false 存档的格式或者版本不匹配
+     */
+    static bool Load(const vector<uint8_t> &data);
+
+    static void SaveToFile(const string &path);
+
+    static bool LoadFromFile(const string &path);
+};
+} // namespace solis
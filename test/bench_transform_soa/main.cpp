@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "core/math/transform_soa.hpp"
+
+using namespace solis;
+
+// 和components::Transform相同的AoS布局
+struct TransformAoS
+{
+    math::vec3 position;
+    math::vec3 rotation;
+    math::vec3 scale;
+    math::mat4 viewMatrix;
+};
+
+static const size_t Count      = 100000;
+static const int    Iterations = 50;
+
+template <typename Func>
+static double Measure(Func &&func)
+{
+    // 预热一次
+    func();
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < Iterations; ++i)
+    {
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - begin).count() / Iterations;
+}
+
+int main()
+{
+    std::mt19937                          random(42);
+    std::uniform_real_distribution<float> distribution(-3.0f, 3.0f);
+
+    vector<TransformAoS> transforms(Count);
+    TransformSoA         soa;
+    soa.Resize(Count);
+    for (size_t i = 0; i < Count; ++i)
+    {
+        auto &transform    = transforms[i];
+        transform.position = math::vec3(distribution(random), distribution(random), distribution(random));
+        transform.rotation = math::vec3(distribution(random), distribution(random), distribution(random));
+        transform.scale    = math::vec3(1.0f + distribution(random) * 0.1f);
+        soa.Set(i, transform.position, math::quat(transform.rotation), transform.scale);
+    }
+
+    vector<math::mat4> glmMatrices(Count);
+    vector<math::mat4> scalarMatrices(Count);
+    vector<math::mat4> simdMatrices(Count);
+
+    // 原来的路径: 每个对象 translate * mat4_cast(quat(euler)) * scale
+    auto glmTime = Measure([&]() {
+        for (size_t i = 0; i < Count; ++i)
+        {
+            auto &transform = transforms[i];
+            auto  matrix    = math::translate(math::mat4(1.0f), transform.position) * math::mat4_cast(math::quat(transform.rotation));
+            glmMatrices[i]  = math::scale(matrix, transform.scale);
+        }
+    });
+    auto scalarTime = Measure([&]() { soa.ComposeScalar(0, Count, scalarMatrices.data()); });
+    auto simdTime   = Measure([&]() { soa.Compose(0, Count, simdMatrices.data()); });
+
+    // 检查结果一致
+    float maxError = 0.0f;
+    for (size_t i = 0; i < Count; ++i)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            for (int row = 0; row < 4; ++row)
+            {
+                maxError = std::max(maxError, std::abs(glmMatrices[i][column][row] - simdMatrices[i][column][row]));
+                maxError = std::max(maxError, std::abs(scalarMatrices[i][column][row] - simdMatrices[i][column][row]));
+            }
+        }
+    }
+
+    std::printf("transforms: %zu, iterations: %d\n", Count, Iterations);
+    std::printf("glm per object : %8.3f ms\n", glmTime);
+    std::printf("soa scalar     : %8.3f ms (%.2fx)\n", scalarTime, glmTime / scalarTime);
+    std::printf("soa %-6s     : %8.3f ms (%.2fx)\n", TransformSoA::GetSimdName(), simdTime, glmTime / simdTime);
+    std::printf("max error      : %g\n", maxError);
+    return maxError < 1e-4f ? 0 : 1;
+}
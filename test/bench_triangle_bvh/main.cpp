@@ -0,0 +1,147 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "core/math/triangle_bvh.hpp"
+
+using namespace solis;
+
+// 起伏的地形网格加上随机散布的小三角形, 大约是Sponza的两倍三角形数量
+static const uint32_t GridSize       = 400;
+static const uint32_t ScatteredCount = 200000;
+static const uint32_t RayCount       = 100000;
+static const uint32_t BruteForceRays = 200;
+
+// 暴力求交, 用于检查结果
+static bool BruteForce(const vector<math::vec3> &positions, const vector<uint32_t> &indices, const Ray &ray, float &distance)
+{
+    distance = ray.maxDistance;
+    bool found = false;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        auto &v0    = positions[indices[i]];
+        auto  edge1 = positions[indices[i + 1]] - v0;
+        auto  edge2 = positions[indices[i + 2]] - v0;
+        auto  p     = math::cross(ray.direction, edge2);
+        auto  det   = math::dot(edge1, p);
+        if (std::abs(det) < 1e-12f)
+        {
+            continue;
+        }
+        auto s = ray.origin - v0;
+        auto u = math::dot(s, p) / det;
+        auto q = math::cross(s, edge1);
+        auto v = math::dot(ray.direction, q) / det;
+        auto t = math::dot(edge2, q) / det;
+        if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t <= distance)
+        {
+            distance = t;
+            found    = true;
+        }
+    }
+    return found;
+}
+
+int main()
+{
+    std::mt19937                          random(42);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    vector<math::vec3> positions;
+    vector<uint32_t>   indices;
+    for (uint32_t z = 0; z <= GridSize; ++z)
+    {
+        for (uint32_t x = 0; x <= GridSize; ++x)
+        {
+            auto u = x / float(GridSize) * 2.0f - 1.0f;
+            auto v = z / float(GridSize) * 2.0f - 1.0f;
+            positions.emplace_back(u * 50.0f, std::sin(u * 9.0f) * std::cos(v * 7.0f) * 2.0f, v * 50.0f);
+        }
+    }
+    for (uint32_t z = 0; z < GridSize; ++z)
+    {
+        for (uint32_t x = 0; x < GridSize; ++x)
+        {
+            auto i = z * (GridSize + 1) + x;
+            indices.insert(indices.end(), {i, i + 1, i + GridSize + 1, i + 1, i + GridSize + 2, i + GridSize + 1});
+        }
+    }
+    for (uint32_t i = 0; i < ScatteredCount; ++i)
+    {
+        auto center = math::vec3(distribution(random) * 50.0f, 3.0f + (distribution(random) + 1.0f) * 10.0f, distribution(random) * 50.0f);
+        auto base   = static_cast<uint32_t>(positions.size());
+        for (int k = 0; k < 3; ++k)
+        {
+            positions.push_back(center + math::vec3(distribution(random), distribution(random), distribution(random)) * 0.3f);
+        }
+        indices.insert(indices.end(), {base, base + 1, base + 2});
+    }
+
+    TriangleBVH bvh;
+    auto        buildBegin = std::chrono::steady_clock::now();
+    bvh.Build(positions, indices);
+    auto buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildBegin).count();
+
+    // 从网格上方随机位置射向随机方向, 模拟拾取和视线检测
+    vector<Ray> rays(RayCount);
+    for (auto &ray : rays)
+    {
+        ray.origin    = math::vec3(distribution(random) * 60.0f, 30.0f + distribution(random) * 5.0f, distribution(random) * 60.0f);
+        ray.direction = math::normalize(math::vec3(distribution(random), -1.0f - distribution(random) * 0.5f, distribution(random)));
+    }
+
+    size_t hits         = 0;
+    auto   closestBegin = std::chrono::steady_clock::now();
+    for (auto &ray : rays)
+    {
+        RayHit hit;
+        hits += bvh.Raycast(ray, hit) ? 1 : 0;
+    }
+    auto closestTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - closestBegin).count() / RayCount;
+
+    size_t anyHits  = 0;
+    auto   anyBegin = std::chrono::steady_clock::now();
+    for (auto &ray : rays)
+    {
+        anyHits += bvh.RaycastAny(ray) ? 1 : 0;
+    }
+    auto anyTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - anyBegin).count() / RayCount;
+
+    // 世界空间的查询, 实例有旋转和非均匀缩放
+    auto world = math::scale(math::rotate(math::translate(math::mat4(1.0f), math::vec3(10.0f, 0.0f, -5.0f)), 0.7f, math::vec3(0.0f, 1.0f, 0.0f)),
+                             math::vec3(1.5f, 0.5f, 2.0f));
+
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < BruteForceRays; ++i)
+    {
+        auto  &ray = rays[i];
+        RayHit hit;
+        float  expected = 0.0f;
+        bool   found    = bvh.Raycast(ray, hit);
+        if (found != BruteForce(positions, indices, ray, expected) || (found && std::abs(hit.distance - expected) > 1e-3f))
+        {
+            mismatches++;
+        }
+
+        // 世界空间的射线变换到局部空间后应该得到相同的参数
+        Ray worldRay;
+        worldRay.origin    = math::vec3(world * math::vec4(ray.origin, 1.0f));
+        worldRay.direction = math::vec3(world * math::vec4(ray.direction, 0.0f));
+        RayHit worldHit;
+        if (bvh.Raycast(worldRay, world, worldHit) != found || (found && std::abs(worldHit.distance - hit.distance) > 1e-3f))
+        {
+            mismatches++;
+        }
+        if (found && !bvh.IntersectsSegment(worldRay.origin, worldRay.At(hit.distance * 1.01f), world))
+        {
+            mismatches++;
+        }
+    }
+
+    std::printf("triangles: %zu, nodes: %zu, build: %.1f ms\n", bvh.GetTriangleCount(), bvh.GetNodeCount(), buildTime);
+    std::printf("closest hit : %8.3f us/ray (%zu/%u hit)\n", closestTime, hits, RayCount);
+    std::printf("any hit     : %8.3f us/ray (%zu/%u hit)\n", anyTime, anyHits, RayCount);
+    std::printf("mismatches  : %u/%u\n", mismatches, BruteForceRays);
+    return mismatches == 0 && hits == anyHits ? 0 : 1;
+}